@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+using TagId = uint32_t;
+
+// FNV-1a hash of a tag name (evaluated at compile time for string literals)
+constexpr TagId HashTag(std::string_view name)
+{
+	TagId hash = 2166136261u;
+	for (char c : name) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Describes or categorizes an allocation
+// Constructed implicitly from string literals only, e.g. pool.Request("Enemy")
+// Names built at runtime are copied by MemoryTracker::RegisterTag(), which returns a tag pointing at its copy
+// Only the id is stored per allocation, the name is resolved by the MemoryTracker when displayed
+struct Tag {
+	TagId id = 0;
+	const char* name = nullptr; // Kept as a pointer and resolved later, so it has to live for the whole program
+
+	template<size_t N>
+	constexpr Tag(const char (&name)[N]) : id(HashTag(std::string_view(name, N - 1))), name(name) {}
+	constexpr Tag(TagId id, const char* name) : id(id), name(name) {}
+};
+
+namespace Tags {
+	inline constexpr Tag NoTag = "No tag";
+}
@@ -0,0 +1,167 @@
+#include "ArenaMemory.h"
+#include "Settings.h"
+
+#include <iostream>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+	size_t RoundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+#ifdef _WIN32
+	// Large pages require the "Lock pages in memory" privilege (SeLockMemoryPrivilege) for the user
+	bool EnableLockMemoryPrivilege()
+	{
+		static int enabled = -1; // -1 = not yet checked
+		if (enabled != -1) {
+			return enabled == 1;
+		}
+
+		enabled = 0;
+		HANDLE token = nullptr;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+			return false;
+		}
+
+		TOKEN_PRIVILEGES privileges = {};
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		if (LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)) {
+			AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr);
+			enabled = GetLastError() == ERROR_SUCCESS ? 1 : 0;
+		}
+		CloseHandle(token);
+
+		return enabled == 1;
+	}
+#endif
+}
+
+bool ArenaMemory::Allocate(Arena &arena, size_t size, bool hugePages)
+{
+	arena = Arena();
+	arena.size = size;
+
+	if (!hugePages) {
+		arena.memory = malloc(size);
+		arena.reserved = size;
+		arena.backing = ArenaBacking::Heap;
+		return arena.memory != nullptr;
+	}
+
+#ifdef _WIN32
+	// Explicit large pages
+	size_t largePageSize = GetLargePageMinimum();
+	if (largePageSize > 0 && EnableLockMemoryPrivilege()) {
+		size_t reserved = RoundUp(size, largePageSize);
+		arena.memory = VirtualAlloc(nullptr, reserved, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (arena.memory) {
+			arena.reserved = reserved;
+			arena.backing = ArenaBacking::HugePages;
+			return true;
+		}
+	}
+
+	// Windows has no transparent huge pages, fall back to regular pages (64 KiB aligned)
+	arena.reserved = size;
+	arena.memory = VirtualAlloc(nullptr, arena.reserved, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	arena.backing = ArenaBacking::Pages;
+#else
+	size_t reserved = RoundUp(size, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+	// Explicit huge pages (requires pages reserved in /proc/sys/vm/nr_hugepages)
+	void *memory = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory != MAP_FAILED) {
+		arena.memory = memory;
+		arena.reserved = reserved;
+		arena.backing = ArenaBacking::HugePages;
+		return true;
+	}
+#endif
+
+	// Over-reserve by one huge page and trim so the arena starts on a 2 MiB boundary
+	size_t mapped = reserved + HUGE_PAGE_SIZE;
+	char *start = (char *)mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (start == (char *)MAP_FAILED) {
+		std::cerr << "ArenaMemory::Allocate(): Failed to map arena memory" << std::endl;
+		return false;
+	}
+
+	char *aligned = (char *)RoundUp((size_t)start, HUGE_PAGE_SIZE);
+	if (aligned > start) {
+		munmap(start, aligned - start);
+	}
+	char *end = aligned + reserved;
+	if (start + mapped > end) {
+		munmap(end, (start + mapped) - end);
+	}
+
+	arena.memory = aligned;
+	arena.reserved = reserved;
+	arena.backing = ArenaBacking::Pages;
+
+#ifdef MADV_HUGEPAGE
+	if (madvise(aligned, reserved, MADV_HUGEPAGE) == 0) {
+		arena.backing = ArenaBacking::TransparentHugePages;
+	}
+#endif
+#endif
+
+	if (!arena.memory) {
+		std::cerr << "ArenaMemory::Allocate(): Failed to allocate arena memory" << std::endl;
+		return false;
+	}
+
+#ifdef DEBUG
+	std::cout << "ArenaMemory::Allocate(): " << arena.reserved << " bytes backed by " << GetBackingName(arena.backing) << std::endl;
+#endif
+
+	return true;
+}
+
+void ArenaMemory::Free(Arena &arena)
+{
+	if (!arena.memory) {
+		return;
+	}
+
+	if (arena.backing == ArenaBacking::Heap) {
+		free(arena.memory);
+	}
+	else {
+#ifdef _WIN32
+		VirtualFree(arena.memory, 0, MEM_RELEASE);
+#else
+		munmap(arena.memory, arena.reserved);
+#endif
+	}
+
+	arena = Arena();
+}
+
+const char *ArenaMemory::GetBackingName(ArenaBacking backing)
+{
+	switch (backing)
+	{
+	case ArenaBacking::Heap:
+		return "Heap";
+	case ArenaBacking::Pages:
+		return "Pages";
+	case ArenaBacking::HugePages:
+		return "Huge pages";
+	case ArenaBacking::TransparentHugePages:
+		return "Transparent huge pages";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+inline constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // 2 MiB
+
+// How the memory of an arena was obtained (decides how it is released)
+enum class ArenaBacking {
+	Heap,			// malloc
+	Pages,			// Regular OS pages (VirtualAlloc / mmap), used as fallback when huge pages are unavailable
+	HugePages,		// Explicit huge pages (MEM_LARGE_PAGES / MAP_HUGETLB)
+	TransparentHugePages	// 2 MiB aligned OS pages with a huge page hint (madvise(MADV_HUGEPAGE))
+};
+
+// A large block of memory that an allocator carves its allocations from
+struct Arena {
+	void *memory = nullptr;
+	size_t size = 0;	// Requested size in bytes
+	size_t reserved = 0;	// Size actually reserved from the OS (rounded up to the page size)
+	ArenaBacking backing = ArenaBacking::Heap;
+};
+
+namespace ArenaMemory {
+	// Allocates the memory of an arena
+	// If hugePages is true the arena is 2 MiB aligned and backed by huge pages when the OS allows it,
+	// falling back to transparent huge pages and then to regular pages
+	bool Allocate(Arena &arena, size_t size, bool hugePages);
+	// Releases the memory of an arena
+	void Free(Arena &arena);
+
+	// Returns a readable name for the backing (used for debug output and the interface)
+	const char *GetBackingName(ArenaBacking backing);
+}
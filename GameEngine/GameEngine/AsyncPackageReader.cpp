@@ -0,0 +1,423 @@
+#include "AsyncPackageReader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PACKAGE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#else
+#define PACKAGE_HAS_IO_URING 0
+#endif
+
+#if PACKAGE_HAS_IO_URING
+// Submission and completion rings shared with the kernel (used through the raw system calls, no liburing needed)
+struct AsyncRing {
+	int fd = -1;
+	int wakeFd = -1; // eventfd written by Read() to wake the ring thread
+	uint64_t wakeValue = 0;
+
+	void* sqRing = MAP_FAILED;
+	size_t sqRingSize = 0;
+	void* cqRing = MAP_FAILED;
+	size_t cqRingSize = 0;
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t sqesSize = 0;
+
+	unsigned* sqHead = nullptr;
+	unsigned* sqTail = nullptr;
+	unsigned sqMask = 0;
+	unsigned* sqArray = nullptr;
+	unsigned sqEntries = 0;
+
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	unsigned cqMask = 0;
+	io_uring_cqe* cqes = nullptr;
+
+	~AsyncRing()
+	{
+		if (sqes != MAP_FAILED) {
+			munmap(sqes, sqesSize);
+		}
+		if (cqRing != MAP_FAILED && cqRing != sqRing) {
+			munmap(cqRing, cqRingSize);
+		}
+		if (sqRing != MAP_FAILED) {
+			munmap(sqRing, sqRingSize);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (wakeFd >= 0) {
+			close(wakeFd);
+		}
+	}
+};
+
+namespace {
+	// Marks the completion of the read on the eventfd
+	constexpr uint64_t WAKE_USER_DATA = 0;
+
+	unsigned LoadAcquire(const unsigned* value)
+	{
+		return reinterpret_cast<const std::atomic<unsigned>*>(value)->load(std::memory_order_acquire);
+	}
+
+	void StoreRelease(unsigned* value, unsigned newValue)
+	{
+		reinterpret_cast<std::atomic<unsigned>*>(value)->store(newValue, std::memory_order_release);
+	}
+
+	// IORING_OP_READ and the probe both came with Linux 5.6, older kernels fail every read (including the wake read)
+	bool SupportsRead(int ringFd)
+	{
+		constexpr unsigned PROBE_OPS = 256;
+		std::vector<char> buffer(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op), 0);
+		io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+		if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+			return false;
+		}
+		return IORING_OP_READ <= probe->last_op && IORING_OP_READ < probe->ops_len && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+	}
+
+	// Returns nullptr if the kernel has no io_uring (with IORING_OP_READ) or does not allow it (e.g. blocked in containers)
+	std::unique_ptr<AsyncRing> CreateRing(unsigned entries)
+	{
+		auto ring = std::make_unique<AsyncRing>();
+
+		io_uring_params params = {};
+		ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (ring->fd < 0) {
+			return nullptr;
+		}
+
+		if (!SupportsRead(ring->fd)) {
+			return nullptr;
+		}
+
+		ring->wakeFd = eventfd(0, EFD_CLOEXEC);
+		if (ring->wakeFd < 0) {
+			return nullptr;
+		}
+
+		ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMapping) {
+			ring->sqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+		}
+
+		ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+		if (ring->sqRing == MAP_FAILED) {
+			return nullptr;
+		}
+
+		if (singleMapping) {
+			ring->cqRing = ring->sqRing;
+		}
+		else {
+			ring->cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+			if (ring->cqRing == MAP_FAILED) {
+				return nullptr;
+			}
+		}
+
+		ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+		if (ring->sqes == MAP_FAILED) {
+			return nullptr;
+		}
+
+		char* sq = static_cast<char*>(ring->sqRing);
+		ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		ring->sqEntries = params.sq_entries;
+
+		char* cq = static_cast<char*>(ring->cqRing);
+		ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		return ring;
+	}
+
+	// Queues a read, submitted to the kernel by the next io_uring_enter
+	void PushRead(AsyncRing& ring, int fd, uint64_t offset, void* buffer, uint32_t size, uint64_t userData)
+	{
+		unsigned tail = *ring.sqTail;
+		unsigned index = tail & ring.sqMask;
+
+		io_uring_sqe& sqe = ring.sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_READ;
+		sqe.fd = fd;
+		sqe.off = offset;
+		sqe.addr = reinterpret_cast<uint64_t>(buffer);
+		sqe.len = size;
+		sqe.user_data = userData;
+
+		ring.sqArray[index] = index;
+		StoreRelease(ring.sqTail, tail + 1);
+	}
+}
+#else
+struct AsyncRing {};
+#endif
+
+AsyncPackageReader::AsyncPackageReader()
+{
+	unsigned threadCount = PACKAGE_IO_THREADS;
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+#if PACKAGE_HAS_IO_URING
+	_ring = CreateRing(PACKAGE_IO_QUEUE_DEPTH);
+#endif
+
+	if (_ring) {
+		_ringThread = std::thread(&AsyncPackageReader::RingThread, this);
+	}
+	else {
+		// Blocking reads, enough threads to keep the queue depth in flight
+		threadCount = std::max(threadCount, static_cast<unsigned>(PACKAGE_IO_QUEUE_DEPTH / 4));
+	}
+
+	for (unsigned i = 0; i < threadCount; i++) {
+		_workers.emplace_back(&AsyncPackageReader::WorkerThread, this);
+	}
+}
+
+AsyncPackageReader::~AsyncPackageReader()
+{
+	// Reads in the ring are completed first, their completions are run by the workers
+	if (_ringThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_ringStopping = true;
+		}
+#if PACKAGE_HAS_IO_URING
+		uint64_t wake = 1;
+		(void)!write(_ring->wakeFd, &wake, sizeof(wake));
+#endif
+		_ringThread.join();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_taskAvailable.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+void AsyncPackageReader::Read(const PackageFile& file, uint64_t offset, void* buffer, uint64_t size, Completion completed)
+{
+	ReadRequest* request = new ReadRequest{ &file, offset, static_cast<char*>(buffer), size, 0, std::move(completed) };
+
+	if (!_ring) {
+		Post([this, request]() { ReadOnWorker(request); });
+		return;
+	}
+
+#if PACKAGE_HAS_IO_URING
+	// Memory mapped or out of range reads are not worth a ring slot
+	if (file.IsMapped() || offset > file.GetSize() || size > file.GetSize() - offset || size == 0) {
+		Post([this, request]() { ReadOnWorker(request); });
+		return;
+	}
+
+	bool ringFailed;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		ringFailed = _ringFailed;
+		if (!ringFailed) {
+			_submissions.push_back(request);
+		}
+	}
+
+	if (ringFailed) {
+		Post([this, request]() { ReadOnWorker(request); });
+		return;
+	}
+
+	uint64_t wake = 1;
+	(void)!write(_ring->wakeFd, &wake, sizeof(wake));
+#endif
+}
+
+void AsyncPackageReader::Run(std::function<void()> task)
+{
+	Post(std::move(task));
+}
+
+void AsyncPackageReader::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_taskAvailable.notify_one();
+}
+
+void AsyncPackageReader::ReadOnWorker(ReadRequest* request)
+{
+	bool succeeded = request->file->ReadAt(request->offset + request->done, request->buffer + request->done, request->size - request->done);
+	request->completed(succeeded);
+	delete request;
+}
+
+void AsyncPackageReader::WorkerThread()
+{
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+			if (_tasks.empty()) {
+				return;
+			}
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+void AsyncPackageReader::RingThread()
+{
+#if PACKAGE_HAS_IO_URING
+	AsyncRing& ring = *_ring;
+	unsigned inFlight = 0;
+	bool wakeArmed = false;
+
+	// Stops using the ring, Read() and the reads still waiting for it go to the workers
+	// Reads the kernel already has are waited for, their buffers stay in use until they complete
+	auto failRing = [&]() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_ringFailed = true;
+		for (ReadRequest* request : _submissions) {
+			_tasks.push_back([this, request]() { ReadOnWorker(request); });
+		}
+		_submissions.clear();
+		_taskAvailable.notify_all();
+	};
+
+	while (true) {
+		// The eventfd read completes whenever Read() queues a request, so the wait below always wakes up for new reads
+		if (!wakeArmed && !_ringFailed) {
+			PushRead(ring, ring.wakeFd, static_cast<uint64_t>(-1), &ring.wakeValue, sizeof(ring.wakeValue), WAKE_USER_DATA);
+			wakeArmed = true;
+		}
+
+		if (_ringFailed) {
+			failRing(); // Partial or interrupted reads put back since
+			if (inFlight == 0) {
+				return;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			while (!_ringFailed && !_submissions.empty() && inFlight + 1 < ring.sqEntries) {
+				ReadRequest* request = _submissions.front();
+				_submissions.pop_front();
+
+				uint64_t remaining = request->size - request->done;
+				uint32_t size = remaining > 0x40000000 ? 0x40000000 : static_cast<uint32_t>(remaining);
+				PushRead(ring, request->file->GetDescriptor(), request->offset + request->done, request->buffer + request->done, size, reinterpret_cast<uint64_t>(request));
+				inFlight++;
+			}
+
+			if (_ringStopping && _submissions.empty() && inFlight == 0) {
+				return;
+			}
+		}
+
+		// Submits everything queued and waits for at least one completion
+		// Once the ring failed, the reads the kernel still has are polled for instead
+		if (_ringFailed) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		else {
+			unsigned toSubmit = *ring.sqTail - LoadAcquire(ring.sqHead);
+			int result = static_cast<int>(syscall(__NR_io_uring_enter, ring.fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+			if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				std::cerr << "AsyncPackageReader::RingThread(): io_uring_enter failed (errno " << errno << "), reading on worker threads" << std::endl;
+
+				// Reads the kernel did not take are taken back from the submission queue
+				unsigned head = LoadAcquire(ring.sqHead);
+				for (unsigned tail = *ring.sqTail; head != tail; head++) {
+					uint64_t userData = ring.sqes[ring.sqArray[head & ring.sqMask]].user_data;
+					if (userData == WAKE_USER_DATA) {
+						wakeArmed = false;
+						continue;
+					}
+					ReadRequest* request = reinterpret_cast<ReadRequest*>(userData);
+					inFlight--;
+					std::lock_guard<std::mutex> lock(_mutex);
+					_submissions.push_front(request);
+				}
+				StoreRelease(ring.sqTail, head);
+				failRing();
+			}
+		}
+
+		unsigned head = *ring.cqHead;
+		unsigned tail = LoadAcquire(ring.cqTail);
+		for (; head != tail; head++) {
+			const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+			if (cqe.user_data == WAKE_USER_DATA) {
+				wakeArmed = false;
+				if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN && !_ringFailed) {
+					// Without the wake read new reads would go unnoticed
+					std::cerr << "AsyncPackageReader::RingThread(): Wake read failed (errno " << -cqe.res << "), reading on worker threads" << std::endl;
+					failRing();
+				}
+				continue;
+			}
+
+			ReadRequest* request = reinterpret_cast<ReadRequest*>(cqe.user_data);
+			inFlight--;
+
+			if (cqe.res > 0) {
+				request->done += cqe.res;
+				if (request->done == request->size) {
+					Post([request]() {
+						request->completed(true);
+						delete request;
+					});
+					continue;
+				}
+			}
+
+			if (cqe.res > 0 || cqe.res == -EINTR || cqe.res == -EAGAIN) {
+				// Partial or interrupted read, the rest is submitted again
+				std::lock_guard<std::mutex> lock(_mutex);
+				_submissions.push_front(request);
+			}
+			else {
+				// Errors (including kernels without IORING_OP_READ) are retried with a blocking read, which reports them
+				Post([this, request]() { ReadOnWorker(request); });
+			}
+		}
+		StoreRelease(ring.cqHead, head);
+	}
+#endif
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include "PackageFile.h"
+#include "Settings.h"
+
+// io_uring instance of the reader (Linux only)
+struct AsyncRing;
+
+// Reads from package files without blocking the caller, keeping many reads in flight
+// On Linux the reads are submitted to io_uring from a single thread, elsewhere (or if the kernel
+// refuses io_uring) they are spread over a pool of threads doing positional reads
+// If the ring fails while running, the reads still waiting for it are handed to the threads as well
+// Completions run on the worker threads, so decompressing one asset does not hold up other reads
+class AsyncPackageReader
+{
+public:
+	// Called on a worker thread once the read has finished
+	using Completion = std::function<void(bool succeeded)>;
+
+private:
+	struct ReadRequest {
+		const PackageFile* file;
+		uint64_t offset;
+		char* buffer;
+		uint64_t size;
+		uint64_t done; // Bytes read so far, io_uring may complete a read partially
+		Completion completed;
+	};
+
+	std::unique_ptr<AsyncRing> _ring; // nullptr if the worker threads do the reads
+	std::thread _ringThread;
+	std::deque<ReadRequest*> _submissions; // Reads waiting for a free slot in the ring
+	bool _ringStopping = false;
+	std::atomic<bool> _ringFailed{ false }; // Set (under _mutex) by the ring thread before it hands its reads to the workers
+
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void()>> _tasks;
+	bool _stopping = false;
+
+	std::mutex _mutex;
+	std::condition_variable _taskAvailable;
+
+	void WorkerThread();
+	void RingThread();
+	void Post(std::function<void()> task);
+	// Finishes a read with a blocking read on a worker thread
+	void ReadOnWorker(ReadRequest* request);
+
+public:
+	AsyncPackageReader();
+	// Waits for all reads and tasks, none may be added while the reader is destroyed
+	~AsyncPackageReader();
+
+	AsyncPackageReader(const AsyncPackageReader&) = delete;
+	AsyncPackageReader& operator=(const AsyncPackageReader&) = delete;
+
+	// Reads size bytes starting at offset of file into buffer, file and buffer have to stay valid until completed is called
+	void Read(const PackageFile& file, uint64_t offset, void* buffer, uint64_t size, Completion completed);
+	// Runs a task on a worker thread (e.g. decompressing from a mapped package, which needs no read)
+	void Run(std::function<void()> task);
+
+	bool UsesIoUring() const {
+		return _ring != nullptr && !_ringFailed;
+	}
+};
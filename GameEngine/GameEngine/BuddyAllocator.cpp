@@ -9,19 +9,20 @@
 #include "imgui.h"
 #include "rlImGui.h"
 
-int BuddyAllocator::_nextId = 0; // Set the initial id
+template <typename Tracking>
+int BasicBuddyAllocator<Tracking>::_nextId = 0; // Set the initial id
 
-BuddyAllocator::~BuddyAllocator()
+template <typename Tracking>
+BasicBuddyAllocator<Tracking>::~BasicBuddyAllocator()
 {
-	free(_memory);
+	ArenaMemory::Free(_arena);
 	free(_buddies);
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().RemoveAllocator(_id, Allocator::Buddy);
-	}
+	Tracking::RemoveAllocator(_id, Allocator::Buddy);
 }
 
-bool BuddyAllocator::Init(unsigned int size)
+template <typename Tracking>
+bool BasicBuddyAllocator<Tracking>::Init(unsigned int size, bool hugePages)
 {
 	// Check if size is smaller than lower limit (32)
 	if (size < _maxDepthSize) {
@@ -36,11 +37,11 @@ bool BuddyAllocator::Init(unsigned int size)
 		return false;
 	}
 
-	_memory = malloc(size);
-	if (!_memory) {
+	if (!ArenaMemory::Allocate(_arena, size, hugePages)) {
 		std::cerr << "BuddyAllocator::Init(): Failed to allocate memory" << std::endl;
 		return false;
 	}
+	_memory = _arena.memory;
 
 	// Calculate how many slots are needed
 	for (int i = 0; i < log2Size - (std::log(_maxDepthSize) / std::log(2)) + 1; i++) {
@@ -73,14 +74,13 @@ bool BuddyAllocator::Init(unsigned int size)
 	_id = _nextId;
 	_nextId++;
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().TrackAllocator(_id, GetStats());
-	}
+	Tracking::TrackAllocator(_id, GetStats());
 
 	return true;
 }
 
-void *BuddyAllocator::Request(unsigned int size, std::string tag)
+template <typename Tracking>
+void *BasicBuddyAllocator<Tracking>::Request(unsigned int size, Tag tag)
 {
 #ifdef DEBUG
 	std::cout << "Request(" << size << ")" << std::endl;
@@ -104,9 +104,7 @@ void *BuddyAllocator::Request(unsigned int size, std::string tag)
 				if (size > current->size / 2 || current->size == _maxDepthSize) { // Found a free slot for the desired size
 					current->state = 1;
 					_usedMemory += current->size;
-					if (TRACK_MEMORY) {
-						MemoryTracker::Instance().StartTracking(Allocator::Buddy, _id, current->ptr, current->size, tag);
-					}
+					Tracking::StartTracking(Allocator::Buddy, _id, current->ptr, current->size, tag);
 					return current->ptr;
 				}
 				else { // Split
@@ -139,7 +137,8 @@ void *BuddyAllocator::Request(unsigned int size, std::string tag)
 	return nullptr;
 }
 
-bool BuddyAllocator::Free(void *element)
+template <typename Tracking>
+bool BasicBuddyAllocator<Tracking>::Free(void *element)
 {
 	char *elementPtr = (char *)element;
 	if (elementPtr < (char *)_memory || elementPtr > (char *)_buddies[_numBuddies - 1].ptr) {
@@ -155,9 +154,7 @@ bool BuddyAllocator::Free(void *element)
 			current = &_buddies[i];
 			current->state = 0;
 			_usedMemory -= current->size;
-			if (TRACK_MEMORY) {
-				MemoryTracker::Instance().StopTracking(current->ptr);
-			}
+			Tracking::StopTracking(current->ptr);
 
 			if (i % 2 == 1) { // Current is left
 				// Buddy is right
@@ -200,7 +197,8 @@ bool BuddyAllocator::Free(void *element)
 	return true;
 }
 
-BuddyStats BuddyAllocator::GetStats()
+template <typename Tracking>
+BuddyStats BasicBuddyAllocator<Tracking>::GetStats()
 {
 	BuddyStats stats;
 	stats.capacity = _size;
@@ -209,7 +207,8 @@ BuddyStats BuddyAllocator::GetStats()
 	return stats;
 }
 
-void *BuddyAllocator::GetAddress()
+template <typename Tracking>
+void *BasicBuddyAllocator<Tracking>::GetAddress()
 {
 	if (!_memory) {
 		std::cerr << "BuddyAllocator::GetAddress(): Buddy allocator is uninitialized" << std::endl;
@@ -219,7 +218,8 @@ void *BuddyAllocator::GetAddress()
 	return _memory;
 }
 
-void BuddyAllocator::PrintStates()
+template <typename Tracking>
+void BasicBuddyAllocator<Tracking>::PrintStates()
 {
 	for (int i = 0; i < _numBuddies; i++) {
 		std::cout << i << " ";
@@ -245,7 +245,8 @@ void BuddyAllocator::PrintStates()
 	std::cout << std::endl << std::endl;
 }
 
-void BuddyAllocator::DrawInterface()
+template <typename Tracking>
+void BasicBuddyAllocator<Tracking>::DrawInterface()
 {
 	ImDrawList *draw = ImGui::GetWindowDrawList();
 	ImVec2 origin = ImGui::GetCursorScreenPos();
@@ -293,3 +294,6 @@ void BuddyAllocator::DrawInterface()
 	// Move cursor so ImGui continues below the diagram
 	ImGui::Dummy(ImVec2(totalWidth, (maxLevel + 1) *(blockHeight + blockSpacing)));
 }
+
+template class BasicBuddyAllocator<MemoryTracking>;
+template class BasicBuddyAllocator<NoTracking>;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "MemoryTracker.h"
+#include "TrackingPolicy.h"
+#include "ArenaMemory.h"
 #include "Settings.h"
 
 struct Buddy {
@@ -9,7 +11,9 @@ struct Buddy {
 	void *ptr = nullptr;
 };
 
-class BuddyAllocator
+// Tracking is a tracking policy (MemoryTracking or NoTracking, see TrackingPolicy.h)
+template <typename Tracking>
+class BasicBuddyAllocator
 {
 private:
 	int _id = -1; // Allocator id (-1 = uninitialized)
@@ -17,6 +21,7 @@ private:
 
 	unsigned int _size = 0;
 	unsigned int _usedMemory = 0;
+	Arena _arena;
 	void *_memory = nullptr;
 	const int _maxDepthSize = 32;
 
@@ -24,15 +29,16 @@ private:
 	int _numBuddies = 0;
 
 public:
-	BuddyAllocator() = default;
-	~BuddyAllocator();
+	BasicBuddyAllocator() = default;
+	~BasicBuddyAllocator();
 
 	int GetId() {
 		return _id;
 	}
 
-	bool Init(unsigned int size = 1024);
-	void *Request(unsigned int size, std::string tag = "No tag");
+	// If hugePages is true the arena is backed by huge pages when the OS allows it
+	bool Init(unsigned int size = 1024, bool hugePages = HUGE_PAGE_ARENAS);
+	void *Request(unsigned int size, Tag tag = Tags::NoTag);
 	bool Free(void *element);
 
 	// Returns the current stats for the allocator
@@ -46,4 +52,7 @@ public:
 };
 
 // Buddy Allocator:
-// https://bitsquid.blogspot.com/2015/08/allocation-adventures-3-buddy-allocator.html
\ No newline at end of file
+// https://bitsquid.blogspot.com/2015/08/allocation-adventures-3-buddy-allocator.html
+
+using BuddyAllocator = BasicBuddyAllocator<DefaultTracking>;
+using UntrackedBuddyAllocator = BasicBuddyAllocator<NoTracking>;
@@ -0,0 +1,300 @@
+#include "CompactingAllocator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <malloc.h>
+
+#include "imgui.h"
+
+template <typename Tracking>
+int BasicCompactingAllocator<Tracking>::_nextId = 0; // Set the initial id
+
+template <typename Tracking>
+BasicCompactingAllocator<Tracking>::~BasicCompactingAllocator()
+{
+	ArenaMemory::Free(_arena);
+
+	Tracking::RemoveAllocator(_id, Allocator::Compacting);
+}
+
+template <typename Tracking>
+HandleEntry *BasicCompactingAllocator<Tracking>::Resolve(CompactingHandle handle)
+{
+	if (handle.index >= _handles.size()) {
+		return nullptr;
+	}
+
+	HandleEntry *entry = &_handles[handle.index];
+	if (!entry->used || entry->generation != handle.generation) {
+		return nullptr;
+	}
+
+	return entry;
+}
+
+template <typename Tracking>
+uint32_t BasicCompactingAllocator<Tracking>::FindGap(uint32_t size, size_t &orderIndex)
+{
+	// First fit between the used blocks (sorted by offset)
+	uint32_t prevEnd = 0;
+	for (size_t i = 0; i < _order.size(); i++) {
+		const HandleEntry &entry = _handles[_order[i]];
+		if (entry.offset - prevEnd >= size) {
+			orderIndex = i;
+			return prevEnd;
+		}
+		prevEnd = entry.offset + entry.size;
+	}
+
+	// Space after the last block
+	if (_size - prevEnd >= size) {
+		orderIndex = _order.size();
+		return prevEnd;
+	}
+
+	return UINT32_MAX;
+}
+
+template <typename Tracking>
+bool BasicCompactingAllocator<Tracking>::Init(unsigned int size, bool hugePages)
+{
+	if (size < _alignment) {
+		std::cerr << "CompactingAllocator::Init(): Minimum allocator size is: " << std::to_string(_alignment) << std::endl;
+		return false;
+	}
+
+	if (!ArenaMemory::Allocate(_arena, size, hugePages)) {
+		std::cerr << "CompactingAllocator::Init(): Failed to allocate memory" << std::endl;
+		return false;
+	}
+	_memory = _arena.memory;
+
+	_size = size;
+
+	_id = _nextId;
+	_nextId++;
+
+	Tracking::TrackAllocator(_id, GetStats());
+
+	return true;
+}
+
+template <typename Tracking>
+CompactingHandle BasicCompactingAllocator<Tracking>::Request(unsigned int size, Tag tag, RelocateFunction relocate)
+{
+	CompactingHandle handle;
+
+	if (!_memory) {
+		std::cerr << "CompactingAllocator::Request(): Compacting allocator is uninitialized" << std::endl;
+		return handle;
+	}
+
+	// Round up so every allocation starts on an aligned address
+	uint32_t alignedSize = (size + _alignment - 1) & ~(_alignment - 1);
+	if (alignedSize == 0 || alignedSize > _size - _usedMemory) {
+		std::cerr << "CompactingAllocator::Request(): There's no free memory left" << std::endl;
+		return handle;
+	}
+
+	size_t orderIndex = 0;
+	uint32_t offset = FindGap(alignedSize, orderIndex);
+	if (offset == UINT32_MAX) {
+		std::cerr << "CompactingAllocator::Request(): Memory is fragmented, call Defragment() to make room" << std::endl;
+		return handle;
+	}
+
+	// Reuse a free slot in the handle table if possible
+	uint32_t index = 0;
+	if (_freeHandle != -1) {
+		index = static_cast<uint32_t>(_freeHandle);
+		_freeHandle = _handles[index].nextFree;
+	}
+	else {
+		index = static_cast<uint32_t>(_handles.size());
+		_handles.emplace_back();
+	}
+
+	HandleEntry &entry = _handles[index];
+	entry.offset = offset;
+	entry.size = alignedSize;
+	entry.nextFree = -1;
+	entry.relocate = relocate;
+	entry.used = true;
+
+	_order.insert(_order.begin() + orderIndex, index);
+	_usedMemory += alignedSize;
+
+	handle.index = index;
+	handle.generation = entry.generation;
+
+	Tracking::StartTracking(Allocator::Compacting, _id, (char *)_memory + offset, alignedSize, tag);
+
+	return handle;
+}
+
+template <typename Tracking>
+bool BasicCompactingAllocator<Tracking>::Free(CompactingHandle handle)
+{
+	HandleEntry *entry = Resolve(handle);
+	if (!entry) {
+		std::cerr << "CompactingAllocator::Free(): Handle is invalid or already freed" << std::endl;
+		return false;
+	}
+
+	Tracking::StopTracking((char *)_memory + entry->offset);
+
+	// Remove from the offset ordered list
+	auto it = std::lower_bound(_order.begin(), _order.end(), entry->offset,
+		[this](uint32_t index, uint32_t offset) { return _handles[index].offset < offset; });
+	size_t orderIndex = it - _order.begin();
+	_order.erase(it);
+
+	// Everything after the freed block has to be packed again
+	if (orderIndex < _compacted) {
+		_compacted = orderIndex;
+	}
+
+	_usedMemory -= entry->size;
+
+	entry->used = false;
+	entry->generation++;
+	entry->nextFree = _freeHandle;
+	_freeHandle = static_cast<int>(handle.index);
+
+	return true;
+}
+
+template <typename Tracking>
+void *BasicCompactingAllocator<Tracking>::Get(CompactingHandle handle)
+{
+	HandleEntry *entry = Resolve(handle);
+	if (!entry) {
+		std::cerr << "CompactingAllocator::Get(): Handle is invalid or already freed" << std::endl;
+		return nullptr;
+	}
+
+	return (char *)_memory + entry->offset;
+}
+
+template <typename Tracking>
+unsigned int BasicCompactingAllocator<Tracking>::Defragment(unsigned int maxBytes)
+{
+	unsigned int moved = 0;
+	if (maxBytes == 0) {
+		return moved;
+	}
+
+	uint32_t expected = 0; // Where the next block would be if the arena was packed
+	if (_compacted > 0) {
+		const HandleEntry &last = _handles[_order[_compacted - 1]];
+		expected = last.offset + last.size;
+	}
+
+	while (_compacted < _order.size()) {
+		HandleEntry &entry = _handles[_order[_compacted]];
+		if (entry.offset != expected) {
+			// A single block larger than maxBytes is still moved on its own, otherwise compaction would stall
+			if (moved > 0 && moved + entry.size > maxBytes) {
+				break;
+			}
+
+			char *source = (char *)_memory + entry.offset;
+			char *destination = (char *)_memory + expected;
+			if (!entry.relocate) {
+				std::memmove(destination, source, entry.size); // Blocks only move downwards so regions may overlap
+			}
+			else if (destination + entry.size > source) {
+				// Constructing over the live object is not allowed, so go through the scratch buffer
+				_scratch.resize(entry.size / _alignment);
+				entry.relocate(_scratch.data(), source);
+				entry.relocate(destination, _scratch.data());
+			}
+			else {
+				entry.relocate(destination, source);
+			}
+
+			Tracking::MoveTracking(source, destination);
+
+			entry.offset = expected;
+			moved += entry.size;
+		}
+
+		expected += entry.size;
+		_compacted++;
+	}
+
+#ifdef DEBUG
+	if (moved > 0) {
+		std::cout << "CompactingAllocator::Defragment(): Moved " << moved << " bytes" << std::endl;
+	}
+#endif
+
+	return moved;
+}
+
+template <typename Tracking>
+bool BasicCompactingAllocator<Tracking>::IsCompacted()
+{
+	return _compacted == _order.size();
+}
+
+template <typename Tracking>
+CompactingStats BasicCompactingAllocator<Tracking>::GetStats()
+{
+	CompactingStats stats;
+	stats.capacity = _size;
+	stats.usedMemory = _usedMemory;
+	stats.numAllocations = static_cast<int>(_order.size());
+
+	// Largest block that can currently be requested without defragmenting
+	uint32_t prevEnd = 0;
+	for (uint32_t index : _order) {
+		const HandleEntry &entry = _handles[index];
+		stats.largestFreeBlock = std::max(stats.largestFreeBlock, entry.offset - prevEnd);
+		prevEnd = entry.offset + entry.size;
+	}
+	stats.largestFreeBlock = std::max(stats.largestFreeBlock, _size - prevEnd);
+
+	return stats;
+}
+
+template <typename Tracking>
+void *BasicCompactingAllocator<Tracking>::GetAddress()
+{
+	if (!_memory) {
+		std::cerr << "CompactingAllocator::GetAddress(): Compacting allocator is uninitialized" << std::endl;
+		return nullptr;
+	}
+
+	return _memory;
+}
+
+template <typename Tracking>
+void BasicCompactingAllocator<Tracking>::DrawInterface()
+{
+	ImDrawList *draw = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+
+	const float blockHeight = 20.0f;
+	const float totalWidth = ImGui::GetWindowWidth() - 18.0f;
+
+	// Free memory as background, used blocks drawn on top
+	draw->AddRectFilled(origin, ImVec2(origin.x + totalWidth, origin.y + blockHeight), IM_COL32(0, 255, 0, 255));
+
+	for (uint32_t index : _order) {
+		const HandleEntry &entry = _handles[index];
+		float x0 = floorf(origin.x + (float(entry.offset) / _size) * totalWidth);
+		float x1 = floorf(origin.x + (float(entry.offset + entry.size) / _size) * totalWidth);
+
+		draw->AddRectFilled(ImVec2(x0, origin.y), ImVec2(x1, origin.y + blockHeight), IM_COL32(255, 0, 0, 255));
+		draw->AddRect(ImVec2(x0, origin.y), ImVec2(x1, origin.y + blockHeight), IM_COL32(0, 0, 0, 255));
+	}
+
+	// Move cursor so ImGui continues below the diagram
+	ImGui::Dummy(ImVec2(totalWidth, blockHeight));
+}
+
+template class BasicCompactingAllocator<MemoryTracking>;
+template class BasicCompactingAllocator<NoTracking>;
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "MemoryTracker.h"
+#include "TrackingPolicy.h"
+#include "ArenaMemory.h"
+#include "Settings.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Refers to an allocation inside a CompactingAllocator
+// Handles stay valid while the allocation is moved around during defragmentation
+struct CompactingHandle {
+	uint32_t index = UINT32_MAX;	// Slot in the handle table (UINT32_MAX = invalid)
+	uint32_t generation = 0;	// Must match the slot generation (detects stale handles)
+};
+
+// Moves the object at source to destination and destroys the original
+using RelocateFunction = void (*)(void *destination, void *source);
+
+template <typename T>
+void RelocateObject(void *destination, void *source)
+{
+	T *object = static_cast<T *>(source);
+	new (destination) T(std::move(*object));
+	object->~T();
+}
+
+struct HandleEntry {
+	uint32_t offset = 0;	// Offset of the allocation from the start of the arena
+	uint32_t size = 0;	// Size in bytes (rounded up to the allocator alignment)
+	uint32_t generation = 0;	// Incremented every time the slot is freed
+	int nextFree = -1;	// Index of the next free slot in the handle table (-1 = end of list)
+	RelocateFunction relocate = nullptr;	// Used to move the allocation (nullptr = moved with memmove)
+	bool used = false;
+};
+
+// Tracking is a tracking policy (MemoryTracking or NoTracking, see TrackingPolicy.h)
+template <typename Tracking>
+class BasicCompactingAllocator
+{
+private:
+	int _id = -1; // Allocator id (-1 = uninitialized)
+	static int _nextId;
+
+	static constexpr uint32_t _alignment = 16;
+
+	struct alignas(_alignment) ScratchBlock {
+		char bytes[_alignment];
+	};
+	std::vector<ScratchBlock> _scratch;	// Temporary storage when relocating a block onto itself
+
+	Arena _arena;
+	void *_memory = nullptr;
+	uint32_t _size = 0;
+	uint32_t _usedMemory = 0;
+
+	std::vector<HandleEntry> _handles;	// Handle table
+	int _freeHandle = -1;	// Index of the first free slot in the handle table (-1 = none)
+
+	std::vector<uint32_t> _order;	// Used handle indices sorted by offset
+	size_t _compacted = 0;	// Number of blocks at the front of _order that are known to be packed
+
+	// Gets the handle entry if the handle is valid, otherwise nullptr
+	HandleEntry *Resolve(CompactingHandle handle);
+
+	// Returns the offset of the first gap that fits size, or UINT32_MAX if none was found
+	uint32_t FindGap(uint32_t size, size_t &orderIndex);
+
+public:
+	BasicCompactingAllocator() = default;
+	~BasicCompactingAllocator();
+
+	int GetId() {
+		return _id;
+	}
+
+	// If hugePages is true the arena is backed by huge pages when the OS allows it
+	bool Init(unsigned int size = 1024, bool hugePages = HUGE_PAGE_ARENAS);
+	// Allocations without a relocate function must be trivially copyable, they are moved with memmove
+	CompactingHandle Request(unsigned int size, Tag tag = Tags::NoTag, RelocateFunction relocate = nullptr);
+	// Requests room for a T, which is relocated by move construction if it isn't trivially copyable
+	template <typename T>
+	CompactingHandle Request(Tag tag = Tags::NoTag)
+	{
+		static_assert(alignof(T) <= _alignment, "CompactingAllocator can't align T");
+		return Request(sizeof(T), tag, std::is_trivially_copyable_v<T> ? nullptr : &RelocateObject<T>);
+	}
+	bool Free(CompactingHandle handle);
+
+	// Gets the current address of the allocation
+	// The pointer is only valid until the next call to Defragment()
+	void *Get(CompactingHandle handle);
+
+	// Moves allocations towards the start of the arena to close gaps between them
+	// At most maxBytes are moved per call so the work can be spread over several frames
+	// A budget of 0 moves nothing, returns the amount of bytes that were moved
+	unsigned int Defragment(unsigned int maxBytes);
+	// Returns true if there are no gaps between allocations
+	bool IsCompacted();
+
+	// Returns the current stats for the allocator
+	CompactingStats GetStats();
+
+	// Returns address of the allocators memory
+	void *GetAddress();
+	void DrawInterface();
+};
+
+using CompactingAllocator = BasicCompactingAllocator<DefaultTracking>;
+using UntrackedCompactingAllocator = BasicCompactingAllocator<NoTracking>;
@@ -1,5 +1,12 @@
 #include "Entity.h"
 
+Entity::Entity(Entity &&other) noexcept
+	: _transform(other._transform), _mesh(other._mesh), _texture(other._texture)
+{
+	other._mesh = nullptr;
+	other._texture = nullptr;
+}
+
 bool Entity::Init()
 {
 	return true;
@@ -23,6 +23,8 @@ protected:
 
 public:
 	Entity() = default;
+	// Takes over the resources of other, used when the entity is relocated in memory
+	Entity(Entity &&other) noexcept;
 	virtual ~Entity() = default;
 
 	virtual bool Init();
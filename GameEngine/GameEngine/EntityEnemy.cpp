@@ -7,8 +7,12 @@
 
 EntityEnemy::~EntityEnemy()
 {
-    ResourceManager::Instance().UnloadResource("5f1e388c-39c4-471d-bfa2-727ab986dd1c");
-    ResourceManager::Instance().UnloadResource("4fee39f8-43fc-46ba-9263-2081981e4637");
+    if (_mesh) {
+        ResourceManager::Instance().UnloadResource("5f1e388c-39c4-471d-bfa2-727ab986dd1c");
+    }
+    if (_texture) {
+        ResourceManager::Instance().UnloadResource("4fee39f8-43fc-46ba-9263-2081981e4637");
+    }
 }
 
 bool EntityEnemy::Init()
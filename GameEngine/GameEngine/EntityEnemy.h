@@ -8,6 +8,7 @@ private:
 
 public:
 	EntityEnemy() = default;
+	EntityEnemy(EntityEnemy &&other) = default;
 	~EntityEnemy() override;
 
 	bool Init() override;
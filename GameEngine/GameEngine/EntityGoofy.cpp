@@ -6,8 +6,13 @@
 
 EntityGoofy::~EntityGoofy()
 {
-    ResourceManager::Instance().UnloadResource("9da063c3-6b94-4df3-859e-6f23319b13e8");
-    ResourceManager::Instance().UnloadResource("bd692322-f24c-41a4-a68e-bd31d954ac02");
+    // A moved-from entity no longer owns its resources
+    if (_mesh) {
+        ResourceManager::Instance().UnloadResource("9da063c3-6b94-4df3-859e-6f23319b13e8");
+    }
+    if (_texture) {
+        ResourceManager::Instance().UnloadResource("bd692322-f24c-41a4-a68e-bd31d954ac02");
+    }
 }
 
 bool EntityGoofy::Init()
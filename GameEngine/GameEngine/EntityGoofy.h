@@ -8,6 +8,7 @@ private:
 
 public:
 	EntityGoofy() = default;
+	EntityGoofy(EntityGoofy &&other) = default;
 	~EntityGoofy() override;
 
 	bool Init() override;
@@ -7,7 +7,9 @@
 EntityMushroom::~EntityMushroom()
 {
     //ResourceManager::Instance().UnloadResource("bcc3669b-21be-412a-a6f6-7a0d863d51df");
-    ResourceManager::Instance().UnloadResource("bdfc7912-8198-4ae8-911e-d014b51f66f2");
+    if (_mesh) {
+        ResourceManager::Instance().UnloadResource("bdfc7912-8198-4ae8-911e-d014b51f66f2");
+    }
 }
 
 bool EntityMushroom::Init()
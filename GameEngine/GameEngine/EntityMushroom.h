@@ -8,6 +8,7 @@ private:
 
 public:
 	EntityMushroom() = default;
+	EntityMushroom(EntityMushroom &&other) = default;
 	~EntityMushroom() override;
 
 	bool Init() override;
@@ -4,9 +4,12 @@
 #include <fstream>
 #include <filesystem>
 #include <random>
+#include <string_view>
+#include <cstdint>
 #include "Settings.h"
 
 inline constexpr uint32_t GUID_STR_LENGTH = 36; // Length of the guid generated by GenerateGuid
+inline constexpr uint32_t GUID_BINARY_LENGTH = 16; // Bytes of a GUID in binary form (package TOC)
 
 namespace GuidUtils {
 	// Returns a new randomized GUID
@@ -49,6 +52,67 @@ namespace GuidUtils {
 		return ss.str();
 	}
 
+	// Converts a GUID string (8-4-4-4-12 hex digits, any case) into its 16 bytes
+	// Returns false if the string is not a GUID
+	inline bool ParseGuid(std::string_view guid, uint8_t* bytes)
+	{
+		if (guid.size() != GUID_STR_LENGTH) {
+			return false;
+		}
+
+		int byte = 0;
+		for (size_t i = 0; i < guid.size(); i++) {
+			if (i == 8 || i == 13 || i == 18 || i == 23) {
+				if (guid[i] != '-') {
+					return false;
+				}
+				continue;
+			}
+
+			char c = guid[i];
+			int value;
+			if (c >= '0' && c <= '9') {
+				value = c - '0';
+			}
+			else if (c >= 'a' && c <= 'f') {
+				value = c - 'a' + 10;
+			}
+			else if (c >= 'A' && c <= 'F') {
+				value = c - 'A' + 10;
+			}
+			else {
+				return false;
+			}
+
+			if (byte % 2 == 0) {
+				bytes[byte / 2] = static_cast<uint8_t>(value << 4);
+			}
+			else {
+				bytes[byte / 2] |= static_cast<uint8_t>(value);
+			}
+			byte++;
+		}
+
+		return true;
+	}
+
+	// Formats 16 GUID bytes as a lowercase GUID string (same format as GenerateGuid)
+	inline std::string FormatGuid(const uint8_t* bytes)
+	{
+		static const char digits[] = "0123456789abcdef";
+
+		std::string guid;
+		guid.reserve(GUID_STR_LENGTH);
+		for (int i = 0; i < 16; i++) {
+			guid += digits[bytes[i] >> 4];
+			guid += digits[bytes[i] & 0x0F];
+			if (i == 3 || i == 5 || i == 7 || i == 9) {
+				guid += '-';
+			}
+		}
+		return guid;
+	}
+
 	// Gets the GUID of an asset if it has a corresponding .meta file
 	// If no .meta file is found, it will be created and a new GUID will be written into it
 	namespace fs = std::filesystem;
@@ -0,0 +1,294 @@
+#include "HeapTracking.h"
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+#if defined(_WIN32) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+namespace {
+	// Fixed table so tags can be looked up without allocating (called from operator new)
+	constexpr uint32_t TAG_SLOTS = 64;
+
+	struct TagSlot {
+		std::atomic<TagId> id;	// 0 = unused
+		std::atomic<const char*> name;
+		std::atomic<size_t> bytes;
+		std::atomic<size_t> count;
+		std::atomic<uint64_t> allocations;
+	};
+
+	// Slot 0 collects untagged allocations and allocations of tags that did not fit in the table
+	TagSlot g_slots[TAG_SLOTS];
+
+	std::atomic<size_t> g_bytes{ 0 };
+	std::atomic<size_t> g_count{ 0 };
+	std::atomic<uint64_t> g_allocations{ 0 };
+
+	std::atomic<uint64_t> g_frameAllocations{ 0 };
+	std::atomic<uint64_t> g_frameFrees{ 0 };
+	std::atomic<uint64_t> g_frameBytes{ 0 };
+	std::atomic<uint64_t> g_frameMallocs{ 0 };
+	std::atomic<uint64_t> g_frameMallocBytes{ 0 };
+
+	// Slot of the innermost HeapTagScope of the thread
+	thread_local uint32_t t_slot = 0;
+
+	uint32_t FindSlot(Tag tag)
+	{
+		if (tag.id == Tags::NoTag.id || tag.id == 0) {
+			return 0;
+		}
+
+		// Open addressing over slots 1..TAG_SLOTS-1
+		uint32_t start = tag.id % (TAG_SLOTS - 1);
+		for (uint32_t i = 0; i < TAG_SLOTS - 1; i++) {
+			uint32_t slot = 1 + (start + i) % (TAG_SLOTS - 1);
+
+			TagId id = g_slots[slot].id.load(std::memory_order_acquire);
+			if (id == 0) {
+				TagId expected = 0;
+				if (g_slots[slot].id.compare_exchange_strong(expected, tag.id, std::memory_order_acq_rel)) {
+					g_slots[slot].name.store(tag.name, std::memory_order_release);
+					return slot;
+				}
+				id = expected;
+			}
+			if (id == tag.id) {
+				return slot;
+			}
+		}
+
+		return 0;
+	}
+
+#if TRACK_HEAP
+	// Stored in front of every allocation made through operator new
+	struct HeapHeader {
+		uint64_t size;
+		uint16_t slot;
+		uint16_t aligned;	// Allocated with the aligned allocation function
+		uint32_t offset;	// Distance from the start of the block to the returned pointer
+	};
+	static_assert(sizeof(HeapHeader) == 16, "HeapHeader has to keep the default new alignment");
+
+	void* Allocate(size_t size, size_t alignment, bool aligned)
+	{
+		size_t offset = alignment > sizeof(HeapHeader) ? alignment : sizeof(HeapHeader);
+
+		char* base = nullptr;
+		if (aligned) {
+#ifdef _WIN32
+			base = (char*)_aligned_malloc(size + offset, alignment);
+#else
+			base = (char*)aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment);
+#endif
+		}
+		else {
+			base = (char*)malloc(size + offset);
+		}
+		if (!base) {
+			return nullptr;
+		}
+
+		char* user = base + offset;
+		HeapHeader* header = (HeapHeader*)user - 1;
+		header->size = size;
+		header->slot = (uint16_t)t_slot;
+		header->aligned = aligned ? 1 : 0;
+		header->offset = (uint32_t)offset;
+
+		TagSlot& slot = g_slots[t_slot];
+		slot.bytes.fetch_add(size, std::memory_order_relaxed);
+		slot.count.fetch_add(1, std::memory_order_relaxed);
+		slot.allocations.fetch_add(1, std::memory_order_relaxed);
+
+		g_bytes.fetch_add(size, std::memory_order_relaxed);
+		g_count.fetch_add(1, std::memory_order_relaxed);
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		g_frameAllocations.fetch_add(1, std::memory_order_relaxed);
+		g_frameBytes.fetch_add(size, std::memory_order_relaxed);
+
+		return user;
+	}
+
+	void Deallocate(void* ptr)
+	{
+		if (!ptr) {
+			return;
+		}
+
+		HeapHeader* header = (HeapHeader*)ptr - 1;
+		TagSlot& slot = g_slots[header->slot];
+		slot.bytes.fetch_sub(header->size, std::memory_order_relaxed);
+		slot.count.fetch_sub(1, std::memory_order_relaxed);
+
+		g_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+		g_count.fetch_sub(1, std::memory_order_relaxed);
+		g_frameFrees.fetch_add(1, std::memory_order_relaxed);
+
+		char* base = (char*)ptr - header->offset;
+		if (header->aligned) {
+#ifdef _WIN32
+			_aligned_free(base);
+#else
+			free(base);
+#endif
+		}
+		else {
+			free(base);
+		}
+	}
+
+	// Throwing allocation, calls the new handler until it gives up
+	void* AllocateOrThrow(size_t size, size_t alignment, bool aligned)
+	{
+		while (true) {
+			void* ptr = Allocate(size, alignment, aligned);
+			if (ptr) {
+				return ptr;
+			}
+
+			std::new_handler handler = std::get_new_handler();
+			if (!handler) {
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+#endif
+
+#if TRACK_HEAP && defined(_WIN32) && defined(_DEBUG)
+	int MallocHook(int allocType, void*, size_t size, int blockType, long, const unsigned char*, int)
+	{
+		if (blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)) {
+			g_frameMallocs.fetch_add(1, std::memory_order_relaxed);
+			g_frameMallocBytes.fetch_add(size, std::memory_order_relaxed);
+		}
+		return 1; // Let the allocation proceed
+	}
+#endif
+}
+
+bool HeapTracking::InstallMallocHook()
+{
+#if TRACK_HEAP && defined(_WIN32) && defined(_DEBUG)
+	_CrtSetAllocHook(MallocHook);
+	return true;
+#else
+	// glibc removed its malloc hooks and the release CRT has none, only operator new is counted
+	return false;
+#endif
+}
+
+HeapStats HeapTracking::GetStats()
+{
+	HeapStats stats;
+	stats.bytes = g_bytes.load(std::memory_order_relaxed);
+	stats.count = g_count.load(std::memory_order_relaxed);
+	stats.allocations = g_allocations.load(std::memory_order_relaxed);
+	return stats;
+}
+
+std::vector<HeapTagStats> HeapTracking::GetTagStats()
+{
+	std::vector<HeapTagStats> tags;
+	for (uint32_t i = 0; i < TAG_SLOTS; i++) {
+		TagSlot& slot = g_slots[i];
+		if (i != 0 && slot.id.load(std::memory_order_acquire) == 0) {
+			continue;
+		}
+
+		HeapTagStats stats;
+		stats.tag = i == 0 ? Tags::NoTag.id : slot.id.load(std::memory_order_acquire);
+		stats.name = i == 0 ? Tags::NoTag.name : slot.name.load(std::memory_order_acquire);
+		stats.bytes = slot.bytes.load(std::memory_order_relaxed);
+		stats.count = slot.count.load(std::memory_order_relaxed);
+		stats.allocations = slot.allocations.load(std::memory_order_relaxed);
+		if (stats.allocations > 0) {
+			tags.push_back(stats);
+		}
+	}
+	return tags;
+}
+
+HeapFrameStats HeapTracking::EndFrame()
+{
+	HeapFrameStats stats;
+	stats.allocations = g_frameAllocations.exchange(0, std::memory_order_relaxed);
+	stats.frees = g_frameFrees.exchange(0, std::memory_order_relaxed);
+	stats.bytes = g_frameBytes.exchange(0, std::memory_order_relaxed);
+	stats.mallocs = g_frameMallocs.exchange(0, std::memory_order_relaxed);
+	stats.mallocBytes = g_frameMallocBytes.exchange(0, std::memory_order_relaxed);
+	return stats;
+}
+
+HeapTagScope::HeapTagScope(Tag tag)
+	: _previous(t_slot)
+{
+	t_slot = FindSlot(tag);
+}
+
+HeapTagScope::~HeapTagScope()
+{
+	t_slot = _previous;
+}
+
+#if TRACK_HEAP
+// Replacements of the global allocation functions, all forms are counted through Allocate() and Deallocate()
+
+void* operator new(size_t size)
+{
+	return AllocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false);
+}
+
+void* operator new[](size_t size)
+{
+	return AllocateOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return AllocateOrThrow(size, (size_t)alignment, true);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return AllocateOrThrow(size, (size_t)alignment, true);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return Allocate(size, (size_t)alignment, true);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return Allocate(size, (size_t)alignment, true);
+}
+
+void operator delete(void* ptr) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { Deallocate(ptr); }
+#endif
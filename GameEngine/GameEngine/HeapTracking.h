@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AllocationTag.h"
+#include "Settings.h"
+
+// Accounting of general heap traffic (operator new/delete, optionally malloc) next to the custom allocators
+// Enabled with TRACK_HEAP, the global operator new/delete are then replaced by counting versions
+// Allocations are attributed to the innermost HeapTagScope of the allocating thread
+
+// Live heap usage attributed to one tag
+struct HeapTagStats {
+	TagId tag = Tags::NoTag.id;
+	const char* name = nullptr;
+	size_t bytes = 0;
+	size_t count = 0;
+	uint64_t allocations = 0;	// Allocations made since startup
+};
+
+struct HeapStats {
+	size_t bytes = 0;	// Live bytes allocated through operator new
+	size_t count = 0;	// Live allocations made through operator new
+	uint64_t allocations = 0;	// Allocations made since startup
+};
+
+// Heap traffic during one frame
+struct HeapFrameStats {
+	uint64_t allocations = 0;	// operator new calls
+	uint64_t frees = 0;	// operator delete calls
+	uint64_t bytes = 0;	// Bytes requested through operator new
+	uint64_t mallocs = 0;	// malloc calls seen by the CRT hook (includes the ones made by operator new)
+	uint64_t mallocBytes = 0;
+};
+
+namespace HeapTracking {
+	// True if the global operator new/delete are replaced (TRACK_HEAP)
+	constexpr bool IsEnabled() {
+		return TRACK_HEAP;
+	}
+
+	// Installs the malloc hook where the CRT supports it (debug CRT on Windows), returns false if unavailable
+	bool InstallMallocHook();
+
+	HeapStats GetStats();
+	// Live usage of every tag that has allocated from the heap
+	std::vector<HeapTagStats> GetTagStats();
+
+	// Returns the traffic since the last call and starts counting the next frame
+	HeapFrameStats EndFrame();
+}
+
+// Attributes heap allocations of the calling thread to a tag while the scope is alive
+// e.g. HeapTagScope scope("Packages"); before loading an asset
+class HeapTagScope
+{
+private:
+	uint32_t _previous;
+
+public:
+	explicit HeapTagScope(Tag tag);
+	~HeapTagScope();
+
+	HeapTagScope(const HeapTagScope&) = delete;
+	HeapTagScope& operator=(const HeapTagScope&) = delete;
+};
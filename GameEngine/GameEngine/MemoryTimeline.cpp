@@ -0,0 +1,269 @@
+#include "MemoryTimeline.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+	const char* GetEventName(TrackingEventType type)
+	{
+		switch (type)
+		{
+		case TrackingEventType::Start:
+			return "Alloc";
+		case TrackingEventType::Stop:
+			return "Free";
+		case TrackingEventType::Move:
+			return "Move";
+		default:
+			return "Unknown";
+		}
+	}
+
+	std::string GetTagName(const std::unordered_map<TagId, std::string>& tagNames, TagId tag)
+	{
+		auto element = tagNames.find(tag);
+		return element != tagNames.end() ? element->second : "Unknown tag";
+	}
+
+	// Escapes a string for use inside a JSON string literal
+	std::string EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+				escaped += c;
+			}
+			else if ((unsigned char)c < 0x20) {
+				escaped += ' ';
+			}
+			else {
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+
+	// Quotes a CSV field if needed
+	std::string EscapeCsv(const std::string& text)
+	{
+		if (text.find_first_of(",\"\n") == std::string::npos) {
+			return text;
+		}
+
+		std::string escaped = "\"";
+		for (char c : text) {
+			if (c == '"') {
+				escaped += '"';
+			}
+			escaped += c;
+		}
+		return escaped + "\"";
+	}
+}
+
+MemoryTimeline::MemoryTimeline(size_t eventCapacity, size_t frameCapacity)
+{
+	_events.resize(eventCapacity > 0 ? eventCapacity : 1);
+	_frames.resize(frameCapacity > 0 ? frameCapacity : 1);
+	_start = std::chrono::steady_clock::now();
+}
+
+const TimelineEvent& MemoryTimeline::GetEvent(size_t index) const
+{
+	return _events[(_eventHead + _events.size() - _eventCount + index) % _events.size()];
+}
+
+const FrameSample& MemoryTimeline::GetFrameSample(size_t index) const
+{
+	return _frames[(_frameHead + _frames.size() - _frameCount + index) % _frames.size()];
+}
+
+double MemoryTimeline::ToMicroseconds(std::chrono::steady_clock::time_point time) const
+{
+	return std::chrono::duration<double, std::micro>(time - _start).count();
+}
+
+void MemoryTimeline::RecordEvent(const TimelineEvent& event)
+{
+	TimelineEvent& slot = _events[_eventHead];
+	slot = event;
+	slot.frame = _frame;
+
+	_eventHead = (_eventHead + 1) % _events.size();
+	if (_eventCount < _events.size()) {
+		_eventCount++;
+	}
+
+	if (event.type == TrackingEventType::Start) {
+		_frameAllocations++;
+	}
+	else if (event.type == TrackingEventType::Stop) {
+		_frameFrees++;
+	}
+}
+
+FrameSample& MemoryTimeline::EndFrame(size_t liveBytes, size_t liveCount, size_t heapBytes, const HeapFrameStats& heap)
+{
+	FrameSample& sample = _frames[_frameHead];
+	sample.frame = _frame;
+	sample.timestamp = std::chrono::steady_clock::now();
+	sample.liveBytes = liveBytes;
+	sample.liveCount = liveCount;
+	sample.allocations = _frameAllocations;
+	sample.frees = _frameFrees;
+	sample.allocators.clear();
+	sample.heapBytes = heapBytes;
+	sample.heap = heap;
+
+	_frameHead = (_frameHead + 1) % _frames.size();
+	if (_frameCount < _frames.size()) {
+		_frameCount++;
+	}
+
+	_frame++;
+	_frameAllocations = 0;
+	_frameFrees = 0;
+
+	return sample;
+}
+
+void MemoryTimeline::GetLiveBytesHistory(std::vector<float>& bytes) const
+{
+	bytes.resize(_frameCount);
+	for (size_t i = 0; i < _frameCount; i++) {
+		bytes[i] = (float)GetFrameSample(i).liveBytes;
+	}
+}
+
+void MemoryTimeline::GetAllocationsHistory(std::vector<float>& allocations) const
+{
+	allocations.resize(_frameCount);
+	for (size_t i = 0; i < _frameCount; i++) {
+		allocations[i] = (float)GetFrameSample(i).allocations;
+	}
+}
+
+void MemoryTimeline::GetHeapHistory(std::vector<float>& liveBytes, std::vector<float>& allocations) const
+{
+	liveBytes.resize(_frameCount);
+	allocations.resize(_frameCount);
+	for (size_t i = 0; i < _frameCount; i++) {
+		liveBytes[i] = (float)GetFrameSample(i).heapBytes;
+		allocations[i] = (float)GetFrameSample(i).heap.allocations;
+	}
+}
+
+void MemoryTimeline::GetAllocatorHistory(Allocator allocator, int id, std::vector<float>& bytes) const
+{
+	bytes.assign(_frameCount, 0.0f);
+	for (size_t i = 0; i < _frameCount; i++) {
+		for (const AllocatorSample& sample : GetFrameSample(i).allocators) {
+			if (sample.allocator == allocator && sample.id == id) {
+				bytes[i] = (float)sample.bytes;
+				break;
+			}
+		}
+	}
+}
+
+bool MemoryTimeline::ExportChromeTrace(const std::string& path, const std::unordered_map<TagId, std::string>& tagNames) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cerr << "MemoryTimeline::ExportChromeTrace(): Failed to open " << path << std::endl;
+		return false;
+	}
+	file << std::fixed << std::setprecision(3); // Timestamps to the nanosecond, 6 significant digits would merge events after a second
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	// One track (thread) per allocator instance
+	for (size_t i = 0; i < _eventCount; i++) {
+		const TimelineEvent& event = GetEvent(i);
+		file << (first ? "" : ",\n");
+		first = false;
+
+		file << "{\"name\":\"" << GetEventName(event.type) << " " << EscapeJson(GetTagName(tagNames, event.tag)) << "\""
+			<< ",\"cat\":\"" << GetEventName(event.type) << "\",\"ph\":\"i\",\"s\":\"t\""
+			<< ",\"ts\":" << ToMicroseconds(event.timestamp)
+			<< ",\"pid\":0,\"tid\":\"" << GetAllocatorName(event.allocator) << " " << event.allocatorId << "\""
+			<< ",\"args\":{\"ptr\":\"" << event.ptr << "\",\"size\":" << event.size << ",\"frame\":" << event.frame;
+		if (event.type == TrackingEventType::Move) {
+			file << ",\"newPtr\":\"" << event.newPtr << "\"";
+		}
+		file << "}}";
+	}
+
+	// Usage counters at the end of every frame
+	for (size_t i = 0; i < _frameCount; i++) {
+		const FrameSample& sample = GetFrameSample(i);
+		double ts = ToMicroseconds(sample.timestamp);
+		file << (first ? "" : ",\n");
+		first = false;
+
+		file << "{\"name\":\"Live bytes\",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":0,\"args\":{\"bytes\":" << sample.liveBytes << "}},\n"
+			<< "{\"name\":\"Events per frame\",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":0,\"args\":{\"allocations\":" << sample.allocations << ",\"frees\":" << sample.frees << "}}";
+		if (HeapTracking::IsEnabled()) {
+			file << ",\n{\"name\":\"Heap bytes\",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":0,\"args\":{\"bytes\":" << sample.heapBytes << "}},\n"
+				<< "{\"name\":\"Heap events per frame\",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":0,\"args\":{\"allocations\":" << sample.heap.allocations
+				<< ",\"frees\":" << sample.heap.frees << ",\"mallocs\":" << sample.heap.mallocs << "}}";
+		}
+		for (const AllocatorSample& allocator : sample.allocators) {
+			file << ",\n{\"name\":\"" << GetAllocatorName(allocator.allocator) << " " << allocator.id << " bytes\",\"ph\":\"C\",\"ts\":" << ts
+				<< ",\"pid\":0,\"args\":{\"bytes\":" << allocator.bytes << "}}";
+		}
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
+
+bool MemoryTimeline::ExportEventsCsv(const std::string& path, const std::unordered_map<TagId, std::string>& tagNames) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cerr << "MemoryTimeline::ExportEventsCsv(): Failed to open " << path << std::endl;
+		return false;
+	}
+	file << std::fixed << std::setprecision(3);
+
+	file << "time_us,frame,event,allocator,allocator_id,ptr,new_ptr,size,tag\n";
+	for (size_t i = 0; i < _eventCount; i++) {
+		const TimelineEvent& event = GetEvent(i);
+		file << ToMicroseconds(event.timestamp) << ',' << event.frame << ',' << GetEventName(event.type) << ','
+			<< GetAllocatorName(event.allocator) << ',' << event.allocatorId << ',' << event.ptr << ','
+			<< event.newPtr << ',' << event.size << ',' << EscapeCsv(GetTagName(tagNames, event.tag)) << '\n';
+	}
+
+	return file.good();
+}
+
+bool MemoryTimeline::ExportFramesCsv(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cerr << "MemoryTimeline::ExportFramesCsv(): Failed to open " << path << std::endl;
+		return false;
+	}
+	file << std::fixed << std::setprecision(3);
+
+	file << "frame,time_us,live_bytes,live_count,allocations,frees,heap_bytes,heap_allocations,heap_frees,heap_allocated_bytes,mallocs,malloc_bytes,"
+		<< "allocator,allocator_id,allocator_bytes,allocator_count\n";
+	for (size_t i = 0; i < _frameCount; i++) {
+		const FrameSample& sample = GetFrameSample(i);
+		file << sample.frame << ',' << ToMicroseconds(sample.timestamp) << ',' << sample.liveBytes << ',' << sample.liveCount << ','
+			<< sample.allocations << ',' << sample.frees << ',' << sample.heapBytes << ',' << sample.heap.allocations << ','
+			<< sample.heap.frees << ',' << sample.heap.bytes << ',' << sample.heap.mallocs << ',' << sample.heap.mallocBytes << ",,,,\n";
+
+		// Per allocator rows repeat the frame so the file can be filtered by allocator
+		for (const AllocatorSample& allocator : sample.allocators) {
+			file << sample.frame << ',' << ToMicroseconds(sample.timestamp) << ",,,,,,,,,,," << GetAllocatorName(allocator.allocator) << ','
+				<< allocator.id << ',' << allocator.bytes << ',' << allocator.count << '\n';
+		}
+	}
+
+	return file.good();
+}
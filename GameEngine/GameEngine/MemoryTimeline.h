@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+#include "MemoryTracker.h"
+#include "HeapTracking.h"
+#include "Settings.h"
+
+// An allocation event as stored in the timeline
+struct TimelineEvent {
+	TrackingEventType type = TrackingEventType::Start;
+	Allocator allocator = Allocator::Stack;
+	int allocatorId = -1;
+	void* ptr = nullptr;
+	void* newPtr = nullptr;	// Destination of a move
+	size_t size = 0;
+	TagId tag = Tags::NoTag.id;
+	uint64_t frame = 0;	// Frame the event was applied in
+	std::chrono::steady_clock::time_point timestamp;	// When the allocating thread recorded the event
+};
+
+// Tracked usage of one allocator instance at the end of a frame
+struct AllocatorSample {
+	Allocator allocator = Allocator::Stack;
+	int id = -1;
+	size_t bytes = 0;
+	size_t count = 0;
+};
+
+struct FrameSample {
+	uint64_t frame = 0;
+	std::chrono::steady_clock::time_point timestamp;
+	size_t liveBytes = 0;
+	size_t liveCount = 0;
+	uint32_t allocations = 0;	// Allocations made during the frame
+	uint32_t frees = 0;	// Allocations freed during the frame
+	std::vector<AllocatorSample> allocators;
+
+	// General heap (only counted with TRACK_HEAP)
+	size_t heapBytes = 0;
+	HeapFrameStats heap;
+};
+
+// Fixed-size history of allocation events and per frame usage samples
+// Once a buffer is full the oldest entries are overwritten
+// Not thread-safe, owned and locked by the MemoryTracker
+class MemoryTimeline
+{
+private:
+	std::vector<TimelineEvent> _events;
+	size_t _eventHead = 0;	// Next slot to write
+	size_t _eventCount = 0;
+
+	std::vector<FrameSample> _frames;
+	size_t _frameHead = 0;	// Next slot to write
+	size_t _frameCount = 0;
+
+	uint64_t _frame = 0;	// Current frame
+	uint32_t _frameAllocations = 0;
+	uint32_t _frameFrees = 0;
+
+	std::chrono::steady_clock::time_point _start;	// Exported times are relative to this
+
+	// Oldest first
+	const TimelineEvent& GetEvent(size_t index) const;
+	const FrameSample& GetFrameSample(size_t index) const;
+
+	double ToMicroseconds(std::chrono::steady_clock::time_point time) const;
+
+public:
+	MemoryTimeline(size_t eventCapacity = TIMELINE_EVENT_CAPACITY, size_t frameCapacity = TIMELINE_FRAME_CAPACITY);
+
+	// Stores an event in the current frame
+	void RecordEvent(const TimelineEvent& event);
+	// Stores the usage sample of the current frame and starts the next one
+	// The caller fills in the allocators of the returned sample (the vector keeps its capacity between frames)
+	FrameSample& EndFrame(size_t liveBytes, size_t liveCount, size_t heapBytes, const HeapFrameStats& heap);
+
+	uint64_t GetFrame() const {
+		return _frame;
+	}
+
+	// Oldest frame first, one value per stored frame
+	void GetLiveBytesHistory(std::vector<float>& bytes) const;
+	void GetAllocationsHistory(std::vector<float>& allocations) const;
+	void GetHeapHistory(std::vector<float>& liveBytes, std::vector<float>& allocations) const;
+	// Tracked bytes of one allocator instance (0 for frames where it had no allocations)
+	void GetAllocatorHistory(Allocator allocator, int id, std::vector<float>& bytes) const;
+
+	// Writes the events as instant events and the frame samples as counters (chrome://tracing, Perfetto)
+	bool ExportChromeTrace(const std::string& path, const std::unordered_map<TagId, std::string>& tagNames) const;
+	// One row per event
+	bool ExportEventsCsv(const std::string& path, const std::unordered_map<TagId, std::string>& tagNames) const;
+	// One row per frame sample
+	bool ExportFramesCsv(const std::string& path) const;
+};
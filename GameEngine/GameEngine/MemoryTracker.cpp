@@ -1,43 +1,682 @@
 #include "MemoryTracker.h"
+#include "MemoryTimeline.h"
+#include "HeapTracking.h"
 #include <iostream>
+#include <algorithm>
+#include <unordered_set>
 
-void MemoryTracker::StartTracking(Allocator allocator, int allocatorId, void* ptr, size_t size, std::string tag)
+void TrackingEventBuffer::BeginRecord()
 {
-	Allocation allocation;
-	allocation.allocator = allocator;
-	allocation.allocatorId = allocatorId;
-	allocation.ptr = ptr;
-	allocation.size = size;
-	allocation.tag = tag;
-	allocation.timestamp = std::chrono::system_clock::now();
+	// The previous timestamp bounds the next one without reading the clock
+	// seq_cst keeps the store ahead of the clock read that follows (a release store could still sit in the store buffer)
+	_recordingSince.store(_lastTimestamp, std::memory_order_seq_cst);
+}
+
+void TrackingEventBuffer::EndRecord(std::chrono::steady_clock::time_point timestamp)
+{
+	_lastTimestamp = timestamp.time_since_epoch().count();
+	_recordingSince.store(INT64_MAX, std::memory_order_release);
+}
 
-	_allocations.emplace(ptr, allocation);
+std::chrono::steady_clock::time_point TrackingEventBuffer::GetRecordingSince()
+{
+	int64_t since = _recordingSince.load(std::memory_order_seq_cst);
+	if (since == INT64_MAX) {
+		return std::chrono::steady_clock::time_point::max();
+	}
+	return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(since));
+}
+
+void TrackingEventBuffer::Push(TrackingEvent&& event)
+{
+	size_t head = _head.load(std::memory_order_relaxed);
+	size_t tail = _tail.load(std::memory_order_acquire);
+
+	if (!_overflowing.load(std::memory_order_acquire) && head - tail < _capacity) {
+		_events[head % _capacity] = std::move(event);
+		_head.store(head + 1, std::memory_order_release); // Publish the event to the consumer
+		return;
+	}
+
+	// Slow path, the consumer has not kept up
+	std::lock_guard<std::mutex> lock(_overflowMutex);
+	_overflow.push_back(std::move(event));
+	_overflowing.store(true, std::memory_order_release);
+}
+
+void TrackingEventBuffer::Drain(std::vector<TrackingEvent>& output)
+{
+	size_t tail = _tail.load(std::memory_order_relaxed);
+	size_t head = _head.load(std::memory_order_acquire);
+
+	for (; tail != head; tail++) {
+		output.push_back(std::move(_events[tail % _capacity]));
+	}
+	_tail.store(tail, std::memory_order_release); // Hand the slots back to the producer
+
+	// Events in the overflow were recorded after everything in the ring
+	if (_overflowing.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(_overflowMutex);
+		for (TrackingEvent& event : _overflow) {
+			output.push_back(std::move(event));
+		}
+		_overflow.clear();
+		_overflowing.store(false, std::memory_order_release);
+	}
+}
+
+bool TrackingEventBuffer::IsEmpty()
+{
+	return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire) &&
+		!_overflowing.load(std::memory_order_acquire);
+}
+
+MemoryTracker::MemoryTracker()
+	: _timeline(std::make_unique<MemoryTimeline>())
+{
+}
+
+MemoryTracker::~MemoryTracker() = default;
+
+TrackingEventBuffer& MemoryTracker::GetThreadBuffer()
+{
+	// Marks the buffer when its thread exits so it can be removed once drained
+	struct ThreadBuffer {
+		std::shared_ptr<TrackingEventBuffer> buffer;
+		~ThreadBuffer() {
+			if (buffer) {
+				buffer->threadExited.store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local ThreadBuffer threadBuffer;
+
+	if (!threadBuffer.buffer) {
+		threadBuffer.buffer = std::make_shared<TrackingEventBuffer>();
+
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		_buffers.push_back(threadBuffer.buffer);
+	}
+
+	return *threadBuffer.buffer;
+}
+
+void MemoryTracker::Record(TrackingEvent&& event)
+{
+	// Marked before the timestamp is taken so Flush() knows no earlier event of this thread is still unpublished
+	TrackingEventBuffer& buffer = GetThreadBuffer();
+	buffer.BeginRecord();
+	auto timestamp = std::chrono::steady_clock::now();
+	event.timestamp = timestamp;
+	buffer.Push(std::move(event));
+	buffer.EndRecord(timestamp);
+}
+
+void MemoryTracker::StartTracking(Allocator allocator, int allocatorId, void* ptr, size_t size, Tag tag)
+{
+	TrackingEvent event;
+	event.type = TrackingEventType::Start;
+	event.allocator = allocator;
+	event.allocatorId = allocatorId;
+	event.ptr = ptr;
+	event.size = size;
+	event.tag = tag.id;
+	event.tagName = tag.name;
+
+	Record(std::move(event));
 }
 
 void MemoryTracker::StopTracking(void* ptr)
 {
-	_allocations.erase(ptr);
+	TrackingEvent event;
+	event.type = TrackingEventType::Stop;
+	event.ptr = ptr;
+
+	Record(std::move(event));
+}
+
+void MemoryTracker::MoveTracking(void* from, void* to)
+{
+	TrackingEvent event;
+	event.type = TrackingEventType::Move;
+	event.ptr = from;
+	event.newPtr = to;
+
+	Record(std::move(event));
+}
+
+void MemoryTracker::Flush()
+{
+	{
+		std::lock_guard<std::mutex> lock(_aggregateMutex);
+		FlushLocked();
+	}
+	DispatchBudgetEvents();
+}
+
+void MemoryTracker::EndFrame()
+{
+	std::unique_lock<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	HeapTagScope heapScope("MemoryTracker");
+	FrameSample& sample = _timeline->EndFrame(_totals.bytes, _totals.count, HeapTracking::GetStats().bytes, HeapTracking::EndFrame());
+	for (auto& [key, index] : _allocatorIndex) {
+		AllocatorSample allocator;
+		allocator.allocator = (Allocator)(key >> 32);
+		allocator.id = (int)(uint32_t)key;
+		allocator.bytes = index.counters.bytes;
+		allocator.count = index.counters.count;
+		sample.allocators.push_back(allocator);
+	}
+
+	lock.unlock();
+
+	DispatchBudgetEvents();
+}
+
+void MemoryTracker::FlushLocked()
+{
+	HeapTagScope heapScope("MemoryTracker"); // The tracker's own bookkeeping
+
+	// Events are applied in timestamp order up to a watermark, later ones are held back until the next flush
+	// An event with an earlier timestamp can still be published after its buffer was drained (e.g. the free of a pointer
+	// on one thread racing the flush while another thread already reused the pointer)
+	// Events recorded from here on have later timestamps, events being recorded while a buffer is drained lower the watermark
+	auto watermark = std::chrono::steady_clock::now();
+
+	std::vector<std::shared_ptr<TrackingEventBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		buffers = _buffers;
+	}
+
+	for (auto& buffer : buffers) {
+		watermark = std::min(watermark, buffer->GetRecordingSince());
+		buffer->Drain(_pending);
+	}
+
+	{
+		// Forget buffers of threads that have exited and have nothing left to drain
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		auto newEnd = std::remove_if(_buffers.begin(), _buffers.end(), [](const std::shared_ptr<TrackingEventBuffer>& buffer) {
+			return buffer->threadExited.load(std::memory_order_acquire) && buffer->IsEmpty();
+		});
+		_buffers.erase(newEnd, _buffers.end());
+	}
+
+	if (_pending.empty()) {
+		return;
+	}
+
+	// Merge the threads' events into one timeline (stable to keep the per thread order for equal timestamps)
+	std::stable_sort(_pending.begin(), _pending.end(), [](const TrackingEvent& a, const TrackingEvent& b) {
+		return a.timestamp < b.timestamp;
+	});
+	auto heldBack = std::lower_bound(_pending.begin(), _pending.end(), watermark, [](const TrackingEvent& event, std::chrono::steady_clock::time_point time) {
+		return event.timestamp < time;
+	});
+
+	// Events store steady clock time (cheap to read), allocations are displayed in system time
+	auto steadyNow = std::chrono::steady_clock::now();
+	auto systemNow = std::chrono::system_clock::now();
+
+	for (auto it = _pending.begin(); it != heldBack; ++it) {
+		ApplyEventLocked(*it, steadyNow, systemNow);
+	}
+
+	_pending.erase(_pending.begin(), heldBack);
+}
+
+void MemoryTracker::ApplyEventLocked(const TrackingEvent& event, std::chrono::steady_clock::time_point steadyNow, std::chrono::system_clock::time_point systemNow)
+{
+	switch (event.type)
+	{
+	case TrackingEventType::Start: {
+		RegisterTagLocked(event.tag, event.tagName);
+
+		Allocation allocation;
+		allocation.allocator = event.allocator;
+		allocation.allocatorId = event.allocatorId;
+		allocation.ptr = event.ptr;
+		allocation.size = event.size;
+		allocation.tag = event.tag;
+		allocation.timestamp = systemNow - std::chrono::duration_cast<std::chrono::system_clock::duration>(steadyNow - event.timestamp);
+
+		InsertLocked(allocation);
+
+		TrackedAllocation& tracked = _allocations[event.ptr];
+		tracked.created = event.timestamp;
+		tracked.frame = _timeline->GetFrame();
+
+		TimelineEvent timelineEvent;
+		timelineEvent.type = event.type;
+		timelineEvent.allocator = event.allocator;
+		timelineEvent.allocatorId = event.allocatorId;
+		timelineEvent.ptr = event.ptr;
+		timelineEvent.size = event.size;
+		timelineEvent.tag = event.tag;
+		timelineEvent.timestamp = event.timestamp;
+		_timeline->RecordEvent(timelineEvent);
+		break;
+	}
+	case TrackingEventType::Stop:
+	case TrackingEventType::Move: {
+		// Stop and move events only carry pointers, the rest comes from the tracked allocation
+		auto element = _allocations.find(event.ptr);
+		if (element != _allocations.end()) {
+			const Allocation& allocation = element->second.allocation;
+
+			TimelineEvent timelineEvent;
+			timelineEvent.type = event.type;
+			timelineEvent.allocator = allocation.allocator;
+			timelineEvent.allocatorId = allocation.allocatorId;
+			timelineEvent.ptr = event.ptr;
+			timelineEvent.newPtr = event.newPtr;
+			timelineEvent.size = allocation.size;
+			timelineEvent.tag = allocation.tag;
+			timelineEvent.timestamp = event.timestamp;
+			_timeline->RecordEvent(timelineEvent);
+		}
+
+		if (event.type == TrackingEventType::Stop) {
+			if (element != _allocations.end()) {
+				RecordLifetimeLocked(element->second, event.timestamp);
+			}
+			EraseLocked(event.ptr);
+		}
+		else {
+			MoveLocked(event.ptr, event.newPtr);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void MemoryTracker::ApplyHeldBackLocked(Allocator allocator, int id)
+{
+	// Pointers of the allocator, followed through the held-back events in timestamp order
+	std::unordered_set<void*> owned;
+	auto index = _allocatorIndex.find(AllocatorKey(allocator, id));
+	if (index != _allocatorIndex.end()) {
+		owned.insert(index->second.ptrs.begin(), index->second.ptrs.end());
+	}
+
+	auto steadyNow = std::chrono::steady_clock::now();
+	auto systemNow = std::chrono::system_clock::now();
+
+	auto kept = _pending.begin();
+	for (auto it = _pending.begin(); it != _pending.end(); ++it) {
+		bool ours = false;
+		if (it->type == TrackingEventType::Start) {
+			ours = it->allocator == allocator && it->allocatorId == id;
+			if (ours) {
+				owned.insert(it->ptr);
+			}
+			else {
+				owned.erase(it->ptr); // Handed out by another allocator since
+			}
+		}
+		else if (owned.erase(it->ptr) > 0) {
+			ours = true;
+			if (it->type == TrackingEventType::Move) {
+				owned.insert(it->newPtr);
+			}
+		}
+
+		if (ours) {
+			ApplyEventLocked(*it, steadyNow, systemNow);
+		}
+		else {
+			if (kept != it) {
+				*kept = std::move(*it);
+			}
+			++kept;
+		}
+	}
+	_pending.erase(kept, _pending.end());
+}
+
+namespace {
+	void AddToCounters(AllocationCounters& counters, size_t size)
+	{
+		counters.count++;
+		counters.bytes += size;
+		counters.totalAllocations++;
+		counters.peakBytes = std::max(counters.peakBytes, counters.bytes);
+	}
+
+	void RemoveFromCounters(AllocationCounters& counters, size_t size)
+	{
+		counters.count--;
+		counters.bytes -= size;
+	}
+}
+
+void MemoryTracker::InsertLocked(const Allocation& allocation)
+{
+	// The pointer was handed out again without being freed first (e.g. untracked free), replace the old record
+	if (_allocations.find(allocation.ptr) != _allocations.end()) {
+		EraseLocked(allocation.ptr);
+	}
+
+	AllocationIndex& allocatorIndex = _allocatorIndex[AllocatorKey(allocation.allocator, allocation.allocatorId)];
+	AllocationIndex& tagIndex = _tagIndex[allocation.tag];
+
+	TrackedAllocation& tracked = _allocations[allocation.ptr];
+	tracked.allocation = allocation;
+	tracked.allocatorSlot = allocatorIndex.ptrs.size();
+	tracked.tagSlot = tagIndex.ptrs.size();
+
+	allocatorIndex.ptrs.push_back(allocation.ptr);
+	tagIndex.ptrs.push_back(allocation.ptr);
+
+	AddToCounters(allocatorIndex.counters, allocation.size);
+	AddToCounters(tagIndex.counters, allocation.size);
+	AddToCounters(_totals, allocation.size);
+}
+
+void MemoryTracker::EraseLocked(void* ptr)
+{
+	auto element = _allocations.find(ptr);
+	if (element == _allocations.end()) {
+		return;
+	}
+
+	const Allocation& allocation = element->second.allocation;
+	AllocationIndex& allocatorIndex = _allocatorIndex[AllocatorKey(allocation.allocator, allocation.allocatorId)];
+	AllocationIndex& tagIndex = _tagIndex[allocation.tag];
+
+	// Swap the last pointer of each index into the freed slot
+	void* last = allocatorIndex.ptrs.back();
+	allocatorIndex.ptrs[element->second.allocatorSlot] = last;
+	_allocations[last].allocatorSlot = element->second.allocatorSlot;
+	allocatorIndex.ptrs.pop_back();
+
+	last = tagIndex.ptrs.back();
+	tagIndex.ptrs[element->second.tagSlot] = last;
+	_allocations[last].tagSlot = element->second.tagSlot;
+	tagIndex.ptrs.pop_back();
+
+	RemoveFromCounters(allocatorIndex.counters, allocation.size);
+	RemoveFromCounters(tagIndex.counters, allocation.size);
+	RemoveFromCounters(_totals, allocation.size);
+
+	_allocations.erase(element);
+}
+
+void MemoryTracker::MoveLocked(void* from, void* to)
+{
+	auto node = _allocations.extract(from);
+	if (node.empty()) {
+		std::cerr << "MemoryTracker::MoveTracking(): allocation at pointer is not being tracked" << std::endl;
+		return;
+	}
+
+	TrackedAllocation& tracked = node.mapped();
+	tracked.allocation.ptr = to;
+	_allocatorIndex[AllocatorKey(tracked.allocation.allocator, tracked.allocation.allocatorId)].ptrs[tracked.allocatorSlot] = to;
+	_tagIndex[tracked.allocation.tag].ptrs[tracked.tagSlot] = to;
+
+	node.key() = to;
+	_allocations.insert(std::move(node));
+}
+
+size_t MemoryTracker::CopyPageLocked(const AllocationIndex* index, size_t first, size_t count, std::vector<Allocation>& output)
+{
+	output.clear();
+	if (!index) {
+		return 0;
+	}
+
+	size_t end = std::min(index->ptrs.size(), first + count);
+	for (size_t i = first; i < end; i++) {
+		output.push_back(_allocations.find(index->ptrs[i])->second.allocation);
+	}
+
+	return index->ptrs.size();
+}
+
+void MemoryTracker::RecordLifetimeLocked(const TrackedAllocation& tracked, std::chrono::steady_clock::time_point freed)
+{
+	LifetimeHistogram& histogram = _lifetimes[tracked.allocation.tag];
+
+	double lifetime = std::chrono::duration<double, std::micro>(freed - tracked.created).count();
+	int bucket = 0;
+	while (bucket < LifetimeHistogram::numBuckets - 1 && lifetime >= LifetimeHistogram::GetBucketLimit(bucket)) {
+		bucket++;
+	}
+
+	histogram.buckets[bucket]++;
+	histogram.total++;
+	if (tracked.frame == _timeline->GetFrame()) {
+		histogram.sameFrame++;
+	}
+}
+
+void MemoryTracker::ReportLeaksLocked(Allocator allocator, int id)
+{
+	auto element = _allocatorIndex.find(AllocatorKey(allocator, id));
+	if (element == _allocatorIndex.end() || element->second.ptrs.empty()) {
+		return;
+	}
+
+	LeakReport report;
+	report.allocator = allocator;
+	report.allocatorId = id;
+	report.timestamp = std::chrono::system_clock::now();
+
+	// Group by tag
+	auto now = std::chrono::steady_clock::now();
+	std::unordered_map<TagId, LeakGroup> groups;
+	for (void* ptr : element->second.ptrs) {
+		const TrackedAllocation& tracked = _allocations.find(ptr)->second;
+		double age = std::chrono::duration<double>(now - tracked.created).count();
+
+		LeakGroup& group = groups[tracked.allocation.tag];
+		group.tag = tracked.allocation.tag;
+		group.count++;
+		group.bytes += tracked.allocation.size;
+		group.oldestAge = std::max(group.oldestAge, age);
+		group.averageAge += age; // Summed here, divided below
+
+		report.count++;
+		report.bytes += tracked.allocation.size;
+	}
+
+	for (auto& [tag, group] : groups) {
+		group.averageAge /= group.count;
+		report.groups.push_back(group);
+	}
+	std::sort(report.groups.begin(), report.groups.end(), [](const LeakGroup& a, const LeakGroup& b) {
+		return a.bytes > b.bytes;
+	});
+
+	std::cerr << "MemoryTracker::RemoveAllocator(): " << GetAllocatorName(allocator) << " allocator " << id << " was destroyed with " << report.count
+		<< " live allocations (" << report.bytes << " bytes)" << std::endl;
+	for (const LeakGroup& group : report.groups) {
+		auto name = _tagNames.find(group.tag);
+		std::cerr << "\t" << (name != _tagNames.end() ? name->second : "Unknown tag") << ": " << group.count << " allocations, "
+			<< group.bytes << " bytes, oldest " << group.oldestAge << " s, average age " << group.averageAge << " s" << std::endl;
+	}
+
+	// The memory is gone with the allocator
+	std::vector<void*> leaked = element->second.ptrs;
+	for (void* ptr : leaked) {
+		EraseLocked(ptr);
+	}
+
+	if (_leakReports.size() == _maxLeakReports) {
+		_leakReports.erase(_leakReports.begin());
+	}
+	_leakReports.push_back(std::move(report));
+}
+
+void MemoryTracker::RegisterTagLocked(TagId id, const char* name)
+{
+	if (!name) {
+		return;
+	}
+
+	auto element = _tagNames.find(id);
+	if (element == _tagNames.end()) {
+		_tagNames.emplace(id, name);
+	}
+	else if (element->second != name) {
+		std::cerr << "MemoryTracker::RegisterTag(): tag \"" << name << "\" has the same id as \"" << element->second << "\"" << std::endl;
+	}
+}
+
+Tag MemoryTracker::RegisterTag(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+
+	TagId id = HashTag(name);
+	RegisterTagLocked(id, name.c_str());
+
+	// The map owns the name so the pointer stays valid for as long as the tracker lives
+	return Tag(id, _tagNames.find(id)->second.c_str());
+}
+
+std::string MemoryTracker::GetTagName(TagId id)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+
+	auto element = _tagNames.find(id);
+	if (element == _tagNames.end()) {
+		return "Unknown tag";
+	}
+	return element->second;
 }
 
 bool MemoryTracker::GetAllocation(void* ptr, Allocation& allocation)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
 	auto element = _allocations.find(ptr);
 	if (element == _allocations.end()) {
 		std::cerr << "MemoryTracker::GetAllocation(): allocation at pointer is not being tracked" << std::endl;
 		return false;
 	}
 
-	allocation = element->second; // returns the item (allocation)
+	allocation = element->second.allocation; // returns the item (allocation)
 	return true;
 }
 
 std::unordered_map<void*, Allocation> MemoryTracker::GetAllocations()
 {
-	return _allocations;
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	std::unordered_map<void*, Allocation> allocations;
+	allocations.reserve(_allocations.size());
+	for (auto& [ptr, tracked] : _allocations) {
+		allocations.emplace(ptr, tracked.allocation);
+	}
+	return allocations;
+}
+
+AllocationCounters MemoryTracker::GetTotals()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	return _totals;
+}
+
+AllocationCounters MemoryTracker::GetAllocatorCounters(Allocator allocator, int id)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _allocatorIndex.find(AllocatorKey(allocator, id));
+	if (element == _allocatorIndex.end()) {
+		return AllocationCounters();
+	}
+	return element->second.counters;
+}
+
+AllocationCounters MemoryTracker::GetTagCounters(TagId tag)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _tagIndex.find(tag);
+	if (element == _tagIndex.end()) {
+		return AllocationCounters();
+	}
+	return element->second.counters;
+}
+
+std::vector<std::pair<TagId, AllocationCounters>> MemoryTracker::GetTagCounters()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	std::vector<std::pair<TagId, AllocationCounters>> counters;
+	counters.reserve(_tagIndex.size());
+	for (auto& [tag, index] : _tagIndex) {
+		counters.emplace_back(tag, index.counters);
+	}
+	return counters;
+}
+
+size_t MemoryTracker::GetAllocations(Allocator allocator, int id, size_t first, size_t count, std::vector<Allocation>& output)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _allocatorIndex.find(AllocatorKey(allocator, id));
+	return CopyPageLocked(element != _allocatorIndex.end() ? &element->second : nullptr, first, count, output);
+}
+
+size_t MemoryTracker::GetAllocations(TagId tag, size_t first, size_t count, std::vector<Allocation>& output)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _tagIndex.find(tag);
+	return CopyPageLocked(element != _tagIndex.end() ? &element->second : nullptr, first, count, output);
+}
+
+void MemoryTracker::VisitAllocations(Allocator allocator, int id, const std::function<bool(const Allocation&)>& visitor)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _allocatorIndex.find(AllocatorKey(allocator, id));
+	if (element == _allocatorIndex.end()) {
+		return;
+	}
+	for (void* ptr : element->second.ptrs) {
+		if (!visitor(_allocations.find(ptr)->second.allocation)) {
+			return;
+		}
+	}
+}
+
+void MemoryTracker::VisitAllocations(TagId tag, const std::function<bool(const Allocation&)>& visitor)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _tagIndex.find(tag);
+	if (element == _tagIndex.end()) {
+		return;
+	}
+	for (void* ptr : element->second.ptrs) {
+		if (!visitor(_allocations.find(ptr)->second.allocation)) {
+			return;
+		}
+	}
 }
 
 bool MemoryTracker::GetAllocatorStats(int id, StackStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	auto element = _stackAllocators.find(id);
 	if (element == _stackAllocators.end()) {
 		std::cerr << "MemoryTracker::GetAllocatorStats(): allocator with input id is not being tracked" << std::endl;
@@ -51,11 +690,13 @@ bool MemoryTracker::GetAllocatorStats(int id, StackStats& stats)
 
 std::unordered_map<int, StackStats> MemoryTracker::GetStackAllocators()
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	return _stackAllocators;
 }
 
 bool MemoryTracker::GetAllocatorStats(int id, PoolStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	auto element = _poolAllocators.find(id);
 	if (element == _poolAllocators.end()) {
 		std::cerr << "MemoryTracker::GetAllocatorStats(): allocator with input id is not being tracked" << std::endl;
@@ -69,11 +710,13 @@ bool MemoryTracker::GetAllocatorStats(int id, PoolStats& stats)
 
 std::unordered_map<int, PoolStats> MemoryTracker::GetPoolAllocators()
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	return _poolAllocators;
 }
 
 bool MemoryTracker::GetAllocatorStats(int id, BuddyStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	auto element = _buddyAllocators.find(id);
 	if (element == _buddyAllocators.end()) {
 		std::cerr << "MemoryTracker::GetAllocatorStats(): allocator with input id is not being tracked" << std::endl;
@@ -87,26 +730,62 @@ bool MemoryTracker::GetAllocatorStats(int id, BuddyStats& stats)
 
 std::unordered_map<int, BuddyStats> MemoryTracker::GetBuddyAllocators()
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	return _buddyAllocators;
 }
 
+bool MemoryTracker::GetAllocatorStats(int id, CompactingStats& stats)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	auto element = _compactingAllocators.find(id);
+	if (element == _compactingAllocators.end()) {
+		std::cerr << "MemoryTracker::GetAllocatorStats(): allocator with input id is not being tracked" << std::endl;
+		return false;
+	}
+	else {
+		stats = element->second;
+		return true;
+	}
+}
+
+std::unordered_map<int, CompactingStats> MemoryTracker::GetCompactingAllocators()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	return _compactingAllocators;
+}
+
 void MemoryTracker::TrackAllocator(int id, const StackStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	_stackAllocators[id] = stats;
 }
 
 void MemoryTracker::TrackAllocator(int id, const PoolStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	_poolAllocators[id] = stats;
 }
 
 void MemoryTracker::TrackAllocator(int id, const BuddyStats& stats)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
 	_buddyAllocators[id] = stats;
 }
 
+void MemoryTracker::TrackAllocator(int id, const CompactingStats& stats)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_compactingAllocators[id] = stats;
+}
+
 void MemoryTracker::RemoveAllocator(int id, Allocator allocator)
 {
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+	// Events held back by the flush would otherwise come back as allocations of an allocator that no longer exists
+	ApplyHeldBackLocked(allocator, id);
+	ReportLeaksLocked(allocator, id);
+
 	switch (allocator)
 	{
 	case Allocator::Stack:
@@ -118,7 +797,240 @@ void MemoryTracker::RemoveAllocator(int id, Allocator allocator)
 	case Allocator::Buddy:
 		_buddyAllocators.erase(id);
 		break;
+	case Allocator::Compacting:
+		_compactingAllocators.erase(id);
+		break;
 	default:
 		break;
 	}
+
+	_allocatorIndex.erase(AllocatorKey(allocator, id));
+	_allocatorBudgets.erase(AllocatorKey(allocator, id));
+}
+
+BudgetLevel MemoryTracker::GetLevel(const MemoryBudget& budget, size_t bytes)
+{
+	if (budget.hard > 0 && bytes >= budget.hard) {
+		return BudgetLevel::Hard;
+	}
+	if (budget.soft > 0 && bytes >= budget.soft) {
+		return BudgetLevel::Soft;
+	}
+	return BudgetLevel::Normal;
+}
+
+size_t MemoryTracker::GetAllocatorBytesLocked(uint64_t key)
+{
+	auto element = _allocatorIndex.find(key);
+	return element != _allocatorIndex.end() ? element->second.counters.bytes : 0;
+}
+
+size_t MemoryTracker::GetTagBytesLocked(TagId tag, const BudgetState& state)
+{
+	auto element = _tagIndex.find(tag);
+	return (element != _tagIndex.end() ? element->second.counters.bytes : 0) + state.externalBytes;
+}
+
+void MemoryTracker::DispatchBudgetEvents()
+{
+	std::vector<BudgetEvent> events;
+	std::vector<PressureCallback> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(_aggregateMutex);
+		for (auto& [key, state] : _allocatorBudgets) {
+			size_t bytes = GetAllocatorBytesLocked(key);
+			BudgetLevel level = GetLevel(state.budget, bytes);
+			if (level != state.reportedLevel) {
+				BudgetEvent event;
+				event.allocator = (Allocator)(key >> 32);
+				event.allocatorId = (int)(uint32_t)key;
+				event.level = level;
+				event.previousLevel = state.reportedLevel;
+				event.bytes = bytes;
+				event.budget = state.budget;
+				events.push_back(event);
+				state.reportedLevel = level;
+			}
+		}
+		for (auto& [tag, state] : _tagBudgets) {
+			size_t bytes = GetTagBytesLocked(tag, state);
+			BudgetLevel level = GetLevel(state.budget, bytes);
+			if (level != state.reportedLevel) {
+				BudgetEvent event;
+				event.isTag = true;
+				event.tag = tag;
+				event.level = level;
+				event.previousLevel = state.reportedLevel;
+				event.bytes = bytes;
+				event.budget = state.budget;
+				events.push_back(event);
+				state.reportedLevel = level;
+			}
+		}
+
+		if (events.empty()) {
+			return;
+		}
+		for (auto& [id, callback] : _pressureCallbacks) {
+			callbacks.push_back(callback);
+		}
+	}
+
+	for (const BudgetEvent& event : events) {
+		for (const PressureCallback& callback : callbacks) {
+			callback(event);
+		}
+	}
+}
+
+void MemoryTracker::SetBudget(Allocator allocator, int id, const MemoryBudget& budget)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_allocatorBudgets[AllocatorKey(allocator, id)].budget = budget;
+}
+
+void MemoryTracker::SetBudget(Tag tag, const MemoryBudget& budget)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	RegisterTagLocked(tag.id, tag.name);
+	_tagBudgets[tag.id].budget = budget;
+}
+
+void MemoryTracker::RemoveBudget(Allocator allocator, int id)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_allocatorBudgets.erase(AllocatorKey(allocator, id));
+}
+
+void MemoryTracker::RemoveBudget(TagId tag)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_tagBudgets.erase(tag);
+}
+
+BudgetLevel MemoryTracker::GetBudgetLevel(Allocator allocator, int id)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	uint64_t key = AllocatorKey(allocator, id);
+	auto element = _allocatorBudgets.find(key);
+	if (element == _allocatorBudgets.end()) {
+		return BudgetLevel::Normal;
+	}
+	return GetLevel(element->second.budget, GetAllocatorBytesLocked(key));
+}
+
+BudgetLevel MemoryTracker::GetBudgetLevel(TagId tag)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	auto element = _tagBudgets.find(tag);
+	if (element == _tagBudgets.end()) {
+		return BudgetLevel::Normal;
+	}
+	return GetLevel(element->second.budget, GetTagBytesLocked(tag, element->second));
+}
+
+std::vector<BudgetEvent> MemoryTracker::GetBudgets()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	std::vector<BudgetEvent> budgets;
+	for (auto& [key, state] : _allocatorBudgets) {
+		BudgetEvent budget;
+		budget.allocator = (Allocator)(key >> 32);
+		budget.allocatorId = (int)(uint32_t)key;
+		budget.bytes = GetAllocatorBytesLocked(key);
+		budget.level = GetLevel(state.budget, budget.bytes);
+		budget.previousLevel = state.reportedLevel;
+		budget.budget = state.budget;
+		budgets.push_back(budget);
+	}
+	for (auto& [tag, state] : _tagBudgets) {
+		BudgetEvent budget;
+		budget.isTag = true;
+		budget.tag = tag;
+		budget.bytes = GetTagBytesLocked(tag, state);
+		budget.level = GetLevel(state.budget, budget.bytes);
+		budget.previousLevel = state.reportedLevel;
+		budget.budget = state.budget;
+		budgets.push_back(budget);
+	}
+	return budgets;
+}
+
+void MemoryTracker::SetExternalUsage(Tag tag, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	RegisterTagLocked(tag.id, tag.name);
+	_tagBudgets[tag.id].externalBytes = bytes;
+}
+
+int MemoryTracker::AddPressureCallback(const PressureCallback& callback)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	int id = _nextCallbackId++;
+	_pressureCallbacks.emplace_back(id, callback);
+	return id;
+}
+
+void MemoryTracker::RemovePressureCallback(int id)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	auto newEnd = std::remove_if(_pressureCallbacks.begin(), _pressureCallbacks.end(), [id](const std::pair<int, PressureCallback>& callback) {
+		return callback.first == id;
+	});
+	_pressureCallbacks.erase(newEnd, _pressureCallbacks.end());
+}
+
+std::vector<LeakReport> MemoryTracker::GetLeakReports()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	return _leakReports;
+}
+
+std::vector<std::pair<TagId, LifetimeHistogram>> MemoryTracker::GetLifetimeHistograms()
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	return std::vector<std::pair<TagId, LifetimeHistogram>>(_lifetimes.begin(), _lifetimes.end());
+}
+
+void MemoryTracker::GetFrameHistory(std::vector<float>& liveBytes, std::vector<float>& allocations)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_timeline->GetLiveBytesHistory(liveBytes);
+	_timeline->GetAllocationsHistory(allocations);
+}
+
+void MemoryTracker::GetAllocatorHistory(Allocator allocator, int id, std::vector<float>& bytes)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_timeline->GetAllocatorHistory(allocator, id, bytes);
+}
+
+void MemoryTracker::GetHeapHistory(std::vector<float>& liveBytes, std::vector<float>& allocations)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	_timeline->GetHeapHistory(liveBytes, allocations);
+}
+
+bool MemoryTracker::ExportChromeTrace(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	return _timeline->ExportChromeTrace(path, _tagNames);
+}
+
+bool MemoryTracker::ExportTimelineCsv(const std::string& eventsPath, const std::string& framesPath)
+{
+	std::lock_guard<std::mutex> lock(_aggregateMutex);
+	FlushLocked();
+
+	return _timeline->ExportEventsCsv(eventsPath, _tagNames) && _timeline->ExportFramesCsv(framesPath);
 }
@@ -2,7 +2,17 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "AllocationTag.h"
+
+class MemoryTimeline;
 
 struct StackStats {
 	unsigned int capacity = 0;
@@ -20,26 +30,203 @@ struct BuddyStats {
 	unsigned int usedMemory = 0;
 };
 
+struct CompactingStats {
+	unsigned int capacity = 0;
+	unsigned int usedMemory = 0;
+	unsigned int largestFreeBlock = 0; // Largest request that can be served without defragmenting
+	int numAllocations = 0;
+};
+
 enum class Allocator {
 	Stack,
 	Pool,
-	Buddy
+	Buddy,
+	Compacting
 };
 
+inline const char* GetAllocatorName(Allocator allocator)
+{
+	switch (allocator)
+	{
+	case Allocator::Stack:
+		return "Stack";
+	case Allocator::Pool:
+		return "Pool";
+	case Allocator::Buddy:
+		return "Buddy";
+	case Allocator::Compacting:
+		return "Compacting";
+	default:
+		return "Unknown";
+	}
+}
+
 struct Allocation {
 	Allocator allocator;
 	int allocatorId;
 	void* ptr;
 	size_t size = 0;	// Size in bytes
-	std::string tag;	// Tag describing or categorizing the allocation
+	TagId tag = Tags::NoTag.id;	// Tag describing or categorizing the allocation (name from MemoryTracker::GetTagName())
 	std::chrono::time_point<std::chrono::system_clock> timestamp; // Creation timestamp
 };
 
+// Aggregated counters of a group of allocations (everything, one allocator instance or one tag)
+// Kept up to date when events are flushed so reading them is O(1)
+struct AllocationCounters {
+	size_t count = 0;	// Live allocations
+	size_t bytes = 0;	// Live bytes
+	size_t peakBytes = 0;	// Highest amount of live bytes seen
+	uint64_t totalAllocations = 0;	// Allocations made since tracking started
+};
+
+// Distribution of how long the allocations of a tag lived before they were freed
+struct LifetimeHistogram {
+	static constexpr int numBuckets = 16;
+
+	// Bucket 0 counts lifetimes below 1 us, bucket i counts lifetimes in [4^(i-1), 4^i) us, the last bucket everything above
+	uint64_t buckets[numBuckets] = {};
+	uint64_t sameFrame = 0;	// Freed in the frame they were allocated in (could use a frame arena)
+	uint64_t total = 0;
+
+	// Upper limit of a bucket in microseconds
+	static double GetBucketLimit(int bucket) {
+		double limit = 1.0;
+		for (int i = 0; i < bucket; i++) {
+			limit *= 4.0;
+		}
+		return limit;
+	}
+};
+
+// Allocations of one tag that were still live when their allocator was destroyed
+struct LeakGroup {
+	TagId tag = Tags::NoTag.id;
+	size_t count = 0;
+	size_t bytes = 0;
+	double oldestAge = 0.0;	// Seconds
+	double averageAge = 0.0;	// Seconds
+};
+
+// Created when an allocator is removed while it still has tracked allocations
+struct LeakReport {
+	Allocator allocator = Allocator::Stack;
+	int allocatorId = -1;
+	std::chrono::time_point<std::chrono::system_clock> timestamp;
+	size_t count = 0;
+	size_t bytes = 0;
+	std::vector<LeakGroup> groups;	// Sorted by bytes, largest first
+};
+
+enum class BudgetLevel {
+	Normal,
+	Soft,	// Above the soft limit, systems should start shedding load
+	Hard	// Above the hard limit, systems should stop allocating
+};
+
+// Memory limits in bytes (0 = no limit)
+struct MemoryBudget {
+	size_t soft = 0;
+	size_t hard = 0;
+};
+
+// State of a budget, passed to pressure callbacks when the usage crosses a limit
+struct BudgetEvent {
+	bool isTag = false;	// Tag budget, otherwise allocator budget
+	Allocator allocator = Allocator::Stack;
+	int allocatorId = -1;
+	TagId tag = Tags::NoTag.id;
+	BudgetLevel level = BudgetLevel::Normal;
+	BudgetLevel previousLevel = BudgetLevel::Normal;
+	size_t bytes = 0;
+	MemoryBudget budget;
+};
+
+using PressureCallback = std::function<void(const BudgetEvent&)>;
+
+enum class TrackingEventType {
+	Start,
+	Stop,
+	Move
+};
+
+// Recorded by the allocating thread and applied to the tracked allocations when the tracker is flushed
+struct TrackingEvent {
+	TrackingEventType type = TrackingEventType::Start;
+	Allocator allocator = Allocator::Stack;
+	int allocatorId = -1;
+	void* ptr = nullptr;
+	void* newPtr = nullptr;	// Destination of a move
+	size_t size = 0;
+	TagId tag = Tags::NoTag.id;
+	const char* tagName = nullptr;	// Registered on flush if the id has not been seen before
+	std::chrono::steady_clock::time_point timestamp;
+};
+
+// Single producer (owning thread), single consumer (MemoryTracker::Flush()) event queue
+class TrackingEventBuffer
+{
+private:
+	static constexpr size_t _capacity = 1024;
+
+	TrackingEvent _events[_capacity];
+	std::atomic<size_t> _head{ 0 };	// Next slot to write (only written by the owning thread)
+	std::atomic<size_t> _tail{ 0 };	// Next slot to read (only written by the consumer)
+
+	// Used when the ring is full, events keep going here until the consumer has drained it to preserve ordering
+	std::mutex _overflowMutex;
+	std::vector<TrackingEvent> _overflow;
+	std::atomic<bool> _overflowing{ false };
+
+	// Lower bound of the timestamp of the event the owning thread is recording (INT64_MAX if none)
+	// Nothing published later by this thread has an earlier timestamp
+	std::atomic<int64_t> _recordingSince{ INT64_MAX };
+	int64_t _lastTimestamp = 0;	// Timestamp of the last event of the owning thread, the bound of the next one
+
+public:
+	std::atomic<bool> threadExited{ false };
+
+	// Called by the owning thread before taking the timestamp of an event and after pushing it
+	void BeginRecord();
+	void EndRecord(std::chrono::steady_clock::time_point timestamp);
+	// Called by the owning thread
+	void Push(TrackingEvent&& event);
+	// Called by the consumer before draining, events with earlier timestamps may still be published until the next drain
+	std::chrono::steady_clock::time_point GetRecordingSince();
+	// Called by the consumer, appends all queued events to output
+	void Drain(std::vector<TrackingEvent>& output);
+	bool IsEmpty();
+};
+
 class MemoryTracker 
 {
 private:
-	MemoryTracker() = default;
-	~MemoryTracker() = default;
+	MemoryTracker();
+	~MemoryTracker();
+
+	// Event buffers of all threads that have recorded allocations
+	std::vector<std::shared_ptr<TrackingEventBuffer>> _buffers;
+	std::mutex _buffersMutex;
+
+	// Guards everything below (the aggregated state)
+	std::mutex _aggregateMutex;
+	std::vector<TrackingEvent> _pending; // Events held back until the next flush come first, reused between flushes
+
+	// Names of all tags that have been used or registered (key = tag id)
+	std::unordered_map<TagId, std::string> _tagNames;
+
+	// Stores the tag name if the id is new, _aggregateMutex has to be held
+	void RegisterTagLocked(TagId id, const char* name);
+
+	// Gets the event buffer of the calling thread (registers it on first use)
+	TrackingEventBuffer& GetThreadBuffer();
+	// Records an event into the calling thread's buffer
+	void Record(TrackingEvent&& event);
+	// Applies the buffered events older than the watermark (see FlushLocked), _aggregateMutex has to be held
+	void FlushLocked();
+	// Applies one event to the tracked allocations
+	void ApplyEventLocked(const TrackingEvent& event, std::chrono::steady_clock::time_point steadyNow, std::chrono::system_clock::time_point systemNow);
+	// Applies the held-back events of an allocator that is being removed
+	void ApplyHeldBackLocked(Allocator allocator, int id);
 
 	// Stats of all tracked stack allocators (key = allocator id)
 	std::unordered_map<int, StackStats> _stackAllocators;
@@ -47,9 +234,75 @@ private:
 	std::unordered_map<int, PoolStats> _poolAllocators;
 	// Stats of all tracked buddy allocators (key = allocator id)
 	std::unordered_map<int, BuddyStats> _buddyAllocators;
+	// Stats of all tracked compacting allocators (key = allocator id)
+	std::unordered_map<int, CompactingStats> _compactingAllocators;
+
+	// An allocation and its position in the allocator and tag indexes
+	struct TrackedAllocation {
+		Allocation allocation;
+		size_t allocatorSlot = 0;
+		size_t tagSlot = 0;
+		std::chrono::steady_clock::time_point created;	// For lifetimes (the allocation timestamp is in system time)
+		uint64_t frame = 0;	// Timeline frame the allocation was made in
+	};
+
+	// Live allocations of one allocator instance or tag
+	struct AllocationIndex {
+		std::vector<void*> ptrs;	// Unordered, removing swaps in the last element
+		AllocationCounters counters;
+	};
 
 	// Keeps track of all tracked allocations using their pointers as keys for quick lookup
-	std::unordered_map<void*, Allocation> _allocations;
+	std::unordered_map<void*, TrackedAllocation> _allocations;
+	// Allocations grouped by allocator instance (key = AllocatorKey())
+	std::unordered_map<uint64_t, AllocationIndex> _allocatorIndex;
+	// Allocations grouped by tag (key = tag id)
+	std::unordered_map<TagId, AllocationIndex> _tagIndex;
+	AllocationCounters _totals;
+
+	// History of events and per frame usage
+	std::unique_ptr<MemoryTimeline> _timeline;
+
+	// Lifetimes of freed allocations (key = tag id)
+	std::unordered_map<TagId, LifetimeHistogram> _lifetimes;
+	// Most recent leak reports, oldest first
+	std::vector<LeakReport> _leakReports;
+	static constexpr size_t _maxLeakReports = 32;
+
+	struct BudgetState {
+		MemoryBudget budget;
+		size_t externalBytes = 0;	// Usage reported with SetExternalUsage() (tag budgets only)
+		BudgetLevel reportedLevel = BudgetLevel::Normal;	// Level the callbacks were last told about
+	};
+
+	// Budgets are checked once per flush, not per allocation
+	std::unordered_map<uint64_t, BudgetState> _allocatorBudgets;	// Key = AllocatorKey()
+	std::unordered_map<TagId, BudgetState> _tagBudgets;
+	std::vector<std::pair<int, PressureCallback>> _pressureCallbacks;
+	int _nextCallbackId = 0;
+
+	static BudgetLevel GetLevel(const MemoryBudget& budget, size_t bytes);
+	size_t GetAllocatorBytesLocked(uint64_t key);
+	size_t GetTagBytesLocked(TagId tag, const BudgetState& state);
+	// Calls the pressure callbacks for budgets that changed level, must be called without holding _aggregateMutex
+	void DispatchBudgetEvents();
+
+	// Adds a freed allocation to the lifetime histogram of its tag
+	void RecordLifetimeLocked(const TrackedAllocation& tracked, std::chrono::steady_clock::time_point freed);
+	// Builds a report of the allocations still tracked for an allocator and stops tracking them
+	void ReportLeaksLocked(Allocator allocator, int id);
+
+	static uint64_t AllocatorKey(Allocator allocator, int id) {
+		return ((uint64_t)allocator << 32) | (uint32_t)id;
+	}
+
+	// Index maintenance, _aggregateMutex has to be held
+	void InsertLocked(const Allocation& allocation);
+	void EraseLocked(void* ptr);
+	void MoveLocked(void* from, void* to);
+
+	// Copies up to count allocations of an index starting at first, returns the number of live allocations in the index
+	size_t CopyPageLocked(const AllocationIndex* index, size_t first, size_t count, std::vector<Allocation>& output);
 
 public:
 	// Singleton instance
@@ -67,20 +320,60 @@ public:
 	void TrackAllocator(int id, const PoolStats& stats);
 	// Starts tracking allocator if not already tracked, otherwise updates the allocator stats
 	void TrackAllocator(int id, const BuddyStats& stats);
+	// Starts tracking allocator if not already tracked, otherwise updates the allocator stats
+	void TrackAllocator(int id, const CompactingStats& stats);
 
 	// Stops tracking the allocator with the given id
+	// Allocations that are still tracked for it are reported as leaks and dropped
 	void RemoveAllocator(int id, Allocator allocator);
 
+	// Allocation tracking can be called from any thread, events are buffered per thread without locking
+	// and applied when the tracker is flushed (or queried)
+
 	// Records a new allocation
-	void StartTracking(Allocator allocator, int allocatorId, void* ptr, size_t size, std::string tag);
+	void StartTracking(Allocator allocator, int allocatorId, void* ptr, size_t size, Tag tag);
 	// Removes an allocation from the record
 	void StopTracking(void* ptr);
+	// Updates the pointer of an allocation that has been relocated (keeps tag and timestamp)
+	void MoveTracking(void* from, void* to);
+
+	// Applies all buffered allocation events from every thread
+	void Flush();
+	// Flushes and stores a usage sample of every allocator in the timeline (called once per frame from the main thread)
+	void EndFrame();
+
+	// Creates a tag from a name only known at runtime (string literals can be passed as tags directly)
+	Tag RegisterTag(const std::string& name);
+	// Gets the name of a tag ("Unknown tag" if it has never been used)
+	std::string GetTagName(TagId id);
 
 	// Gets information about the allocation at the given pointer
 	bool GetAllocation(void* ptr, Allocation& allocation);
 	// Gets all currently tracked allocations
+	// Copies every allocation, use the counters and paged queries below for anything done per frame
 	std::unordered_map<void*, Allocation> GetAllocations();
 
+	// Counters over all tracked allocations
+	AllocationCounters GetTotals();
+	// Counters of one allocator instance (all zero if it has no tracked allocations)
+	AllocationCounters GetAllocatorCounters(Allocator allocator, int id);
+	// Counters of one tag (all zero if the tag has never been used)
+	AllocationCounters GetTagCounters(TagId tag);
+	// Counters of every tag that has been used
+	std::vector<std::pair<TagId, AllocationCounters>> GetTagCounters();
+
+	// Paged queries, copy at most count allocations starting at first into output (output is cleared)
+	// Return the number of live allocations in the group so callers can page through it
+	// The order is unspecified and changes when allocations are freed
+	size_t GetAllocations(Allocator allocator, int id, size_t first, size_t count, std::vector<Allocation>& output);
+	size_t GetAllocations(TagId tag, size_t first, size_t count, std::vector<Allocation>& output);
+
+	// Calls visitor for every allocation of an allocator instance until it returns false
+	// The tracker is locked during the visit, the visitor must not call back into the tracker
+	void VisitAllocations(Allocator allocator, int id, const std::function<bool(const Allocation&)>& visitor);
+	// Calls visitor for every allocation with the given tag until it returns false
+	void VisitAllocations(TagId tag, const std::function<bool(const Allocation&)>& visitor);
+
 	// Gets the stats of a tracked allocator with the given id
 	bool GetAllocatorStats(int id, StackStats& stats);
 	// Gets the stats of all trackeded stack allocators
@@ -96,6 +389,46 @@ public:
 	// Gets the stats of all tracked buddy allocators
 	std::unordered_map<int, BuddyStats> GetBuddyAllocators();
 
+	// Gets the stats of a tracked allocator with the given id
+	bool GetAllocatorStats(int id, CompactingStats& stats);
+	// Gets the stats of all tracked compacting allocators
+	std::unordered_map<int, CompactingStats> GetCompactingAllocators();
+
+	// Sets the soft and hard limit of an allocator instance or a tag
+	// Pressure callbacks are called from Flush() and EndFrame() when the usage crosses a limit
+	void SetBudget(Allocator allocator, int id, const MemoryBudget& budget);
+	void SetBudget(Tag tag, const MemoryBudget& budget);
+	void RemoveBudget(Allocator allocator, int id);
+	void RemoveBudget(TagId tag);
+	// Current level of a budget (Normal if there is no budget)
+	BudgetLevel GetBudgetLevel(Allocator allocator, int id);
+	BudgetLevel GetBudgetLevel(TagId tag);
+	// Gets the current state of every budget
+	std::vector<BudgetEvent> GetBudgets();
+
+	// Counts memory that is not allocated through a tracked allocator (e.g. GPU resources) towards a tag budget
+	void SetExternalUsage(Tag tag, size_t bytes);
+
+	// Registers a callback for budget level changes, returns an id for RemovePressureCallback()
+	// Callbacks run on the thread calling Flush() or EndFrame() and may call back into the tracker
+	int AddPressureCallback(const PressureCallback& callback);
+	void RemovePressureCallback(int id);
+
+	// Gets the reports of allocators that were destroyed with live allocations (oldest first)
+	std::vector<LeakReport> GetLeakReports();
+	// Gets the lifetime histogram of every tag that has had allocations freed
+	std::vector<std::pair<TagId, LifetimeHistogram>> GetLifetimeHistograms();
+
+	// Timeline history for graphs, one value per sampled frame (oldest first)
+	void GetFrameHistory(std::vector<float>& liveBytes, std::vector<float>& allocations);
+	void GetAllocatorHistory(Allocator allocator, int id, std::vector<float>& bytes);
+	// Heap usage and operator new calls per frame (all zero unless TRACK_HEAP)
+	void GetHeapHistory(std::vector<float>& liveBytes, std::vector<float>& allocations);
+
+	// Exports the timeline as a Chrome trace (chrome://tracing, Perfetto)
+	bool ExportChromeTrace(const std::string& path);
+	// Exports the timeline events and frame samples as two CSV files
+	bool ExportTimelineCsv(const std::string& eventsPath, const std::string& framesPath);
 
 	// UI Functions
 };
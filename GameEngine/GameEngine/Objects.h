@@ -6,6 +6,14 @@ struct Enemy {
 	char tag = 'a';
 };
 
+// Roughly the size of a game entity (transform, state and some payload)
+struct EntityData {
+	float position[3] = { 0.0f, 0.0f, 0.0f };
+	float velocity[3] = { 1.0f, 0.0f, 0.0f };
+	float health = 100.0f;
+	char payload[228] = {};
+};
+
 struct MainCharacter {
 	float dmg;
 };
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "PackageCompression.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+	// Chunks are only spread over threads if every thread gets at least this many
+	constexpr uint32_t MIN_CHUNKS_PER_THREAD = 2;
+
+	// A dictionary is only built for packages with at least this many small files
+	constexpr size_t MIN_DICTIONARY_FILES = 8;
+	// Bytes sampled from the start of every small file (fewer if there are many files)
+	constexpr size_t MAX_DICTIONARY_SAMPLE = 4096;
+	constexpr size_t MIN_DICTIONARY_SAMPLE = 256;
+
+	// Formats that are compressed already, LZ4 is not tried on them
+	bool IsCompressedFormat(const std::string& extension)
+	{
+		static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".ogg", ".mp3", ".zip", ".gz", ".dds", ".ktx2" };
+		for (const char* compressed : extensions) {
+			if (extension == compressed) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Compresses one block (at most INT_MAX bytes), returns the compressed size or 0 on failure
+	int CompressBlock(const char* source, int size, char* destination, int capacity)
+	{
+		return LZ4_compress_default(source, destination, size, capacity);
+	}
+
+	// Compresses one block with the shared dictionary, returns the compressed size or 0 on failure
+	int CompressBlockWithDictionary(const PackageDictionary& dictionary, const char* source, int size, char* destination, int capacity)
+	{
+		LZ4_stream_t working;
+		LZ4_initStream(&working, sizeof(working));
+		LZ4_attach_dictionary(&working, &dictionary.stream);
+		return LZ4_compress_fast_continue(&working, source, destination, size, capacity, 1);
+	}
+
+	bool DecodeBlock(const char* source, uint64_t sizeCompressed, char* destination, uint64_t size)
+	{
+		if (sizeCompressed > INT_MAX || size > INT_MAX) {
+			return false;
+		}
+
+		int uncompressedSize = LZ4_decompress_safe(source, destination, static_cast<int>(sizeCompressed), static_cast<int>(size));
+		return uncompressedSize >= 0 && static_cast<uint64_t>(uncompressedSize) == size;
+	}
+
+	bool DecodeChunk(const PackageEntry& packageEntry, const std::vector<uint64_t>& offsets, uint32_t chunk, const char* source, char* destination)
+	{
+		uint64_t sizeCompressed = offsets[chunk + 1] - offsets[chunk];
+		uint64_t size = PackageCompression::GetChunkSize(packageEntry, chunk);
+
+		if (sizeCompressed == size) {
+			std::memcpy(destination, source, size);
+			return true;
+		}
+		return DecodeBlock(source, sizeCompressed, destination, size);
+	}
+}
+
+bool PackageCompression::BuildDictionary(const std::vector<std::string>& files, PackageDictionary& dictionary)
+{
+	dictionary.data.clear();
+	if (PACK_DICTIONARY_SIZE <= 0) {
+		return true;
+	}
+
+	// Small files that would be compressed as a single block
+	std::vector<std::string> samples;
+	for (const std::string& file : files) {
+		std::string extension = std::filesystem::path(file).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+		std::error_code error;
+		uint64_t size = std::filesystem::file_size(file, error);
+		if (!error && size > 0 && size <= PACK_CHUNK_SIZE && !IsCompressedFormat(extension)) {
+			samples.push_back(file);
+		}
+	}
+
+	if (samples.size() < MIN_DICTIONARY_FILES) {
+		return true;
+	}
+
+	// The start of every file, files share headers and common tokens (e.g. "v ", "vn ", "f " in .obj files)
+	size_t sampleSize = std::clamp<size_t>(PACK_DICTIONARY_SIZE / samples.size(), MIN_DICTIONARY_SAMPLE, MAX_DICTIONARY_SAMPLE);
+	for (const std::string& file : samples) {
+		std::ifstream in(file, std::ios::binary);
+		if (!in) {
+			std::cerr << "PackageCompression::BuildDictionary(): Could not read " << file << std::endl;
+			return false;
+		}
+
+		size_t start = dictionary.data.size();
+		dictionary.data.resize(start + sampleSize);
+		in.read(dictionary.data.data() + start, sampleSize);
+		dictionary.data.resize(start + static_cast<size_t>(in.gcount()));
+	}
+
+	// LZ4 only references the last 64 KiB, those are kept
+	if (dictionary.data.size() > PACK_DICTIONARY_SIZE) {
+		dictionary.data.erase(dictionary.data.begin(), dictionary.data.end() - PACK_DICTIONARY_SIZE);
+	}
+
+	LoadDictionary(dictionary.data, dictionary);
+	return true;
+}
+
+void PackageCompression::LoadDictionary(const std::vector<char>& data, PackageDictionary& dictionary)
+{
+	if (&data != &dictionary.data) {
+		dictionary.data = data;
+	}
+	if (dictionary.data.empty()) {
+		return;
+	}
+
+	LZ4_initStream(&dictionary.stream, sizeof(dictionary.stream));
+	LZ4_loadDictSlow(&dictionary.stream, dictionary.data.data(), static_cast<int>(dictionary.data.size()));
+}
+
+bool PackageCompression::Compress(std::unique_ptr<char[]>& data, uint64_t size, const std::string& extension, const PackageDictionary& dictionary, PackageEntry& packageEntry)
+{
+	packageEntry.size = size;
+	packageEntry.sizeCompressed = size;
+	packageEntry.codec = PackageCodec::Store;
+	packageEntry.reserved = 0;
+	packageEntry.chunkSize = 0;
+	packageEntry.chunkCount = 0;
+
+	if (size == 0 || IsCompressedFormat(extension)) {
+		return true;
+	}
+
+	PackageEntry compressedEntry = packageEntry;
+	compressedEntry.codec = PackageCodec::LZ4;
+
+	std::unique_ptr<char[]> compressedData;
+	if (size <= PACK_CHUNK_SIZE) {
+		// Single block
+		int maxSizeCompressed = LZ4_compressBound(static_cast<int>(size)); // Maximum size the compressed version can reach
+		compressedData = std::make_unique<char[]>(maxSizeCompressed);
+
+		int sizeCompressed = CompressBlock(data.get(), static_cast<int>(size), compressedData.get(), maxSizeCompressed);
+		if (sizeCompressed == 0) {
+			std::cerr << "PackageCompression::Compress(): Compression error" << std::endl;
+			return false;
+		}
+		compressedEntry.sizeCompressed = static_cast<uint64_t>(sizeCompressed);
+
+		// The shared dictionary is used if it makes the entry smaller
+		if (!dictionary.data.empty()) {
+			std::unique_ptr<char[]> dictionaryData = std::make_unique<char[]>(maxSizeCompressed);
+			int sizeWithDictionary = CompressBlockWithDictionary(dictionary, data.get(), static_cast<int>(size), dictionaryData.get(), maxSizeCompressed);
+			if (sizeWithDictionary > 0 && sizeWithDictionary < sizeCompressed) {
+				compressedData = std::move(dictionaryData);
+				compressedEntry.sizeCompressed = static_cast<uint64_t>(sizeWithDictionary);
+				compressedEntry.codec = PackageCodec::LZ4Dictionary;
+			}
+		}
+	}
+	else {
+		// Chunks, each compressed on its own behind the chunk table
+		compressedEntry.chunkSize = PACK_CHUNK_SIZE;
+		uint64_t chunkCount = (size + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE;
+		if (chunkCount > UINT32_MAX) {
+			std::cerr << "PackageCompression::Compress(): File has too many chunks" << std::endl;
+			return false;
+		}
+		compressedEntry.chunkCount = static_cast<uint32_t>(chunkCount);
+
+		uint64_t tableSize = GetChunkTableSize(compressedEntry);
+		int maxChunkCompressed = LZ4_compressBound(PACK_CHUNK_SIZE);
+		compressedData = std::make_unique<char[]>(tableSize + chunkCount * maxChunkCompressed);
+
+		uint64_t position = tableSize;
+		for (uint32_t chunk = 0; chunk < compressedEntry.chunkCount; chunk++) {
+			const char* source = data.get() + static_cast<uint64_t>(chunk) * PACK_CHUNK_SIZE;
+			uint32_t chunkSize = static_cast<uint32_t>(GetChunkSize(compressedEntry, chunk));
+
+			uint32_t sizeCompressed = static_cast<uint32_t>(CompressBlock(source, chunkSize, compressedData.get() + position, maxChunkCompressed));
+			if (sizeCompressed == 0) {
+				std::cerr << "PackageCompression::Compress(): Compression error" << std::endl;
+				return false;
+			}
+
+			// Chunks that do not shrink are stored raw
+			if (sizeCompressed >= chunkSize) {
+				std::memcpy(compressedData.get() + position, source, chunkSize);
+				sizeCompressed = chunkSize;
+			}
+
+			std::memcpy(compressedData.get() + chunk * sizeof(uint32_t), &sizeCompressed, sizeof(uint32_t));
+			position += sizeCompressed;
+		}
+		compressedEntry.sizeCompressed = position;
+	}
+
+	// Stored unless compression gains enough
+	if (compressedEntry.sizeCompressed < size * (1.0 - PACK_MIN_COMPRESSION_GAIN)) {
+		packageEntry = compressedEntry;
+		data = std::move(compressedData);
+	}
+
+	return true;
+}
+
+bool PackageCompression::Decode(const PackageEntry& packageEntry, const char* source, char* destination, const std::vector<char>& dictionary)
+{
+	switch (packageEntry.codec)
+	{
+	case PackageCodec::Store:
+		std::memcpy(destination, source, packageEntry.size);
+		return true;
+	case PackageCodec::LZ4: {
+		if (packageEntry.chunkCount == 0) {
+			return DecodeBlock(source, packageEntry.sizeCompressed, destination, packageEntry.size);
+		}
+
+		std::vector<uint64_t> offsets;
+		if (!ReadChunkTable(packageEntry, source, offsets)) {
+			return false;
+		}
+		return DecodeChunks(packageEntry, offsets, 0, packageEntry.chunkCount, source + offsets[0], destination);
+	}
+	case PackageCodec::LZ4Dictionary: {
+		if (dictionary.empty() || packageEntry.chunkCount != 0 || packageEntry.sizeCompressed > INT_MAX || packageEntry.size > INT_MAX) {
+			return false;
+		}
+
+		int uncompressedSize = LZ4_decompress_safe_usingDict(source, destination, static_cast<int>(packageEntry.sizeCompressed),
+			static_cast<int>(packageEntry.size), dictionary.data(), static_cast<int>(dictionary.size()));
+		return uncompressedSize >= 0 && static_cast<uint64_t>(uncompressedSize) == packageEntry.size;
+	}
+	default:
+		return false;
+	}
+}
+
+uint64_t PackageCompression::GetChunkTableSize(const PackageEntry& packageEntry)
+{
+	return static_cast<uint64_t>(packageEntry.chunkCount) * sizeof(uint32_t);
+}
+
+uint64_t PackageCompression::GetChunkSize(const PackageEntry& packageEntry, uint32_t chunk)
+{
+	uint64_t start = static_cast<uint64_t>(chunk) * packageEntry.chunkSize;
+	return std::min<uint64_t>(packageEntry.chunkSize, packageEntry.size - start);
+}
+
+bool PackageCompression::HasValidChunkLayout(const PackageEntry& packageEntry)
+{
+	if (packageEntry.chunkSize == 0) {
+		return false;
+	}
+
+	// A chunk starting beyond size would make GetChunkSize wrap around
+	uint64_t chunkCount = packageEntry.size / packageEntry.chunkSize + (packageEntry.size % packageEntry.chunkSize != 0 ? 1 : 0);
+	return packageEntry.chunkCount == chunkCount && GetChunkTableSize(packageEntry) <= packageEntry.sizeCompressed;
+}
+
+bool PackageCompression::ReadChunkTable(const PackageEntry& packageEntry, const char* table, std::vector<uint64_t>& offsets)
+{
+	if (!HasValidChunkLayout(packageEntry)) {
+		std::cerr << "PackageCompression::ReadChunkTable(): Entry has an invalid chunk layout" << std::endl;
+		return false;
+	}
+
+	offsets.resize(static_cast<size_t>(packageEntry.chunkCount) + 1);
+	offsets[0] = GetChunkTableSize(packageEntry);
+	for (uint32_t chunk = 0; chunk < packageEntry.chunkCount; chunk++) {
+		uint32_t sizeCompressed;
+		std::memcpy(&sizeCompressed, table + chunk * sizeof(uint32_t), sizeof(uint32_t)); // The table is not aligned
+		offsets[chunk + 1] = offsets[chunk] + sizeCompressed;
+	}
+
+	if (offsets.back() != packageEntry.sizeCompressed) {
+		std::cerr << "PackageCompression::ReadChunkTable(): Chunk table does not match the entry size" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool PackageCompression::DecodeChunks(const PackageEntry& packageEntry, const std::vector<uint64_t>& offsets, uint32_t first, uint32_t last, const char* source, char* destination)
+{
+	uint32_t count = last - first;
+	auto decode = [&](uint32_t chunk) {
+		return DecodeChunk(packageEntry, offsets, chunk, source + (offsets[chunk] - offsets[first]),
+			destination + static_cast<uint64_t>(chunk - first) * packageEntry.chunkSize);
+	};
+
+	uint32_t threadCount = PACKAGE_DECOMPRESS_THREADS > 0 ? PACKAGE_DECOMPRESS_THREADS : std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, count / MIN_CHUNKS_PER_THREAD);
+
+	if (threadCount <= 1) {
+		for (uint32_t chunk = first; chunk < last; chunk++) {
+			if (!decode(chunk)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The calling thread decodes chunks as well
+	std::atomic<uint32_t> nextChunk{ first };
+	std::atomic<bool> failed{ false };
+	auto worker = [&]() {
+		for (uint32_t chunk = nextChunk++; chunk < last && !failed; chunk = nextChunk++) {
+			if (!decode(chunk)) {
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> helpers;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		helpers.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& helper : helpers) {
+		helper.join();
+	}
+
+	return !failed;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "PackageManager.h"
+
+// Dictionary shared by the small entries of a package, prepared once for compressing on any number of threads
+struct PackageDictionary {
+	std::vector<char> data;
+	LZ4_stream_t stream; // data loaded for LZ4_attach_dictionary
+
+	PackageDictionary() = default;
+	PackageDictionary(const PackageDictionary&) = delete;
+	PackageDictionary& operator=(const PackageDictionary&) = delete;
+};
+
+// Encoding and decoding of package entries
+// Entries larger than PACK_CHUNK_SIZE are split into chunks that are compressed independently,
+// so they can be decompressed on several threads and read partially
+// A chunked entry starts with a table of chunkCount uint32_t compressed chunk sizes followed by the chunks
+// A chunk whose compressed size equals its uncompressed size is stored raw
+// Small single block entries can be compressed with a dictionary shared by the whole package
+namespace PackageCompression {
+	// Builds the shared dictionary from samples of the small files of a package
+	// Leaves the dictionary empty if there are too few files for it to pay off
+	bool BuildDictionary(const std::vector<std::string>& files, PackageDictionary& dictionary);
+	// Prepares the dictionary of an existing package for compressing (entries copied from it stay decodable)
+	void LoadDictionary(const std::vector<char>& data, PackageDictionary& dictionary);
+
+	// Compresses a file with the codec chosen for its extension and size
+	// data holds the file contents on input and the bytes to write to the package on output
+	// Fills in all fields of packageEntry except offset, dictionary may be empty
+	bool Compress(std::unique_ptr<char[]>& data, uint64_t size, const std::string& extension, const PackageDictionary& dictionary, PackageEntry& packageEntry);
+
+	// Decodes a whole entry, source holds its sizeCompressed stored bytes and destination receives size bytes
+	// dictionary is the shared dictionary of the package holding the entry
+	bool Decode(const PackageEntry& packageEntry, const char* source, char* destination, const std::vector<char>& dictionary);
+
+	// Size in bytes of the chunk table at the start of a chunked entry (0 for single block entries)
+	uint64_t GetChunkTableSize(const PackageEntry& packageEntry);
+	// Uncompressed size of one chunk
+	uint64_t GetChunkSize(const PackageEntry& packageEntry, uint32_t chunk);
+	// Checks that a chunked entry has exactly the chunks its size needs and room for their table in its stored bytes
+	// (before the table is read, packages can be damaged)
+	bool HasValidChunkLayout(const PackageEntry& packageEntry);
+	// Converts the chunk table into chunkCount + 1 offsets of the stored chunks, relative to the start of the entry
+	bool ReadChunkTable(const PackageEntry& packageEntry, const char* table, std::vector<uint64_t>& offsets);
+	// Decodes the chunks [first, last), source points at the stored bytes of chunk first
+	// and destination at the uncompressed start of chunk first, large ranges are decoded on several threads
+	bool DecodeChunks(const PackageEntry& packageEntry, const std::vector<uint64_t>& offsets, uint32_t first, uint32_t last, const char* source, char* destination);
+}
@@ -0,0 +1,291 @@
+#include "PackageFile.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <cerrno>
+#endif
+
+struct PackageMapping {
+	void* data = nullptr;
+	uint64_t size = 0;
+
+	~PackageMapping()
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(data, size);
+#endif
+	}
+};
+
+PackageFile::~PackageFile()
+{
+	Close();
+}
+
+PackageFile::PackageFile(PackageFile&& other) noexcept
+	: _handle(other._handle), _size(other._size), _mapping(std::move(other._mapping)), _mappedData(other._mappedData)
+{
+#ifdef _WIN32
+	other._handle = nullptr;
+#else
+	other._handle = -1;
+#endif
+	other._size = 0;
+	other._mappedData = nullptr;
+}
+
+PackageFile& PackageFile::operator=(PackageFile&& other) noexcept
+{
+	if (this != &other) {
+		Close();
+		std::swap(_handle, other._handle);
+		std::swap(_size, other._size);
+		std::swap(_mapping, other._mapping);
+		std::swap(_mappedData, other._mappedData);
+	}
+	return *this;
+}
+
+bool PackageFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		std::cerr << "PackageFile::Open(): Could not open " << path << " (error " << GetLastError() << ")" << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size)) {
+		std::cerr << "PackageFile::Open(): Could not get the size of " << path << std::endl;
+		CloseHandle(handle);
+		return false;
+	}
+
+	_handle = handle;
+	_size = static_cast<uint64_t>(size.QuadPart);
+#else
+	int handle = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (handle == -1) {
+		std::cerr << "PackageFile::Open(): Could not open " << path << " (errno " << errno << ")" << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(handle, &status) != 0) {
+		std::cerr << "PackageFile::Open(): Could not get the size of " << path << std::endl;
+		close(handle);
+		return false;
+	}
+
+	_handle = handle;
+	_size = static_cast<uint64_t>(status.st_size);
+#endif
+
+	return true;
+}
+
+void PackageFile::Close()
+{
+	// Views handed out keep their own reference to the mapping
+	_mapping.reset();
+	_mappedData = nullptr;
+
+#ifdef _WIN32
+	if (_handle) {
+		CloseHandle(static_cast<HANDLE>(_handle));
+		_handle = nullptr;
+	}
+#else
+	if (_handle != -1) {
+		close(_handle);
+		_handle = -1;
+	}
+#endif
+	_size = 0;
+}
+
+bool PackageFile::IsOpen() const
+{
+#ifdef _WIN32
+	return _handle != nullptr;
+#else
+	return _handle != -1;
+#endif
+}
+
+bool PackageFile::ReadAt(uint64_t offset, void* buffer, uint64_t size) const
+{
+	if (!IsOpen()) {
+		std::cerr << "PackageFile::ReadAt(): File is not open" << std::endl;
+		return false;
+	}
+
+	if (offset > _size || size > _size - offset) {
+		std::cerr << "PackageFile::ReadAt(): Read past the end of the file" << std::endl;
+		return false;
+	}
+
+	char* destination = static_cast<char*>(buffer);
+
+	// A single call may return less than requested (and is limited to 32 bits on Windows)
+	while (size > 0) {
+#ifdef _WIN32
+		DWORD request = size > 0x40000000 ? 0x40000000 : static_cast<DWORD>(size);
+
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+		DWORD read = 0;
+		if (!ReadFile(static_cast<HANDLE>(_handle), destination, request, &read, &overlapped) || read == 0) {
+			std::cerr << "PackageFile::ReadAt(): Read failed (error " << GetLastError() << ")" << std::endl;
+			return false;
+		}
+#else
+		size_t request = size > 0x40000000 ? 0x40000000 : static_cast<size_t>(size);
+
+		ssize_t read = pread(_handle, destination, request, static_cast<off_t>(offset));
+		if (read < 0 && errno == EINTR) {
+			continue;
+		}
+		if (read <= 0) {
+			std::cerr << "PackageFile::ReadAt(): Read failed (errno " << errno << ")" << std::endl;
+			return false;
+		}
+#endif
+		destination += read;
+		offset += read;
+		size -= read;
+	}
+
+	return true;
+}
+
+bool PackageFile::Map()
+{
+	if (!IsOpen()) {
+		std::cerr << "PackageFile::Map(): File is not open" << std::endl;
+		return false;
+	}
+
+	if (IsMapped()) {
+		return true;
+	}
+
+	if (_size == 0) {
+		std::cerr << "PackageFile::Map(): Can not map an empty file" << std::endl;
+		return false;
+	}
+
+	auto mapping = std::make_shared<PackageMapping>();
+	mapping->size = _size;
+
+#ifdef _WIN32
+	HANDLE mappingHandle = CreateFileMappingA(static_cast<HANDLE>(_handle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle) {
+		std::cerr << "PackageFile::Map(): CreateFileMapping failed (error " << GetLastError() << ")" << std::endl;
+		return false;
+	}
+
+	// The view stays valid after the mapping handle is closed
+	mapping->data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mappingHandle);
+	if (!mapping->data) {
+		std::cerr << "PackageFile::Map(): MapViewOfFile failed (error " << GetLastError() << ")" << std::endl;
+		return false;
+	}
+#else
+	void* data = mmap(nullptr, static_cast<size_t>(_size), PROT_READ, MAP_SHARED, _handle, 0);
+	if (data == MAP_FAILED) {
+		std::cerr << "PackageFile::Map(): mmap failed (errno " << errno << ")" << std::endl;
+		return false;
+	}
+	mapping->data = data;
+#endif
+
+	_mappedData = static_cast<const char*>(mapping->data);
+	_mapping = std::move(mapping);
+	return true;
+}
+
+void PackageFile::Advise(uint64_t offset, uint64_t size, PackageAccess access) const
+{
+	if (!IsOpen() || offset >= _size) {
+		return;
+	}
+	if (size > _size - offset) {
+		size = _size - offset;
+	}
+
+#ifdef _WIN32
+	// Windows only has an equivalent of WillNeed, and only for mapped files
+	if (IsMapped() && access == PackageAccess::WillNeed) {
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<char*>(_mappedData + offset);
+		range.NumberOfBytes = static_cast<SIZE_T>(size);
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	if (IsMapped()) {
+		// madvise needs a page aligned start
+		uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+		uint64_t start = offset / pageSize * pageSize;
+
+		int advice = MADV_NORMAL;
+		switch (access)
+		{
+		case PackageAccess::Sequential:
+			advice = MADV_SEQUENTIAL;
+			break;
+		case PackageAccess::Random:
+			advice = MADV_RANDOM;
+			break;
+		case PackageAccess::WillNeed:
+			advice = MADV_WILLNEED;
+			break;
+		default:
+			break;
+		}
+		madvise(const_cast<char*>(_mappedData) + start, static_cast<size_t>(size + offset - start), advice);
+	}
+#if defined(POSIX_FADV_NORMAL)
+	else {
+		int advice = POSIX_FADV_NORMAL;
+		switch (access)
+		{
+		case PackageAccess::Sequential:
+			advice = POSIX_FADV_SEQUENTIAL;
+			break;
+		case PackageAccess::Random:
+			advice = POSIX_FADV_RANDOM;
+			break;
+		case PackageAccess::WillNeed:
+			advice = POSIX_FADV_WILLNEED;
+			break;
+		default:
+			break;
+		}
+		posix_fadvise(_handle, static_cast<off_t>(offset), static_cast<off_t>(size), advice);
+	}
+#endif
+#endif
+}
+
+std::shared_ptr<const void> PackageFile::GetMappingOwner() const
+{
+	return _mapping;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Access pattern hints passed on to the OS (madvise / posix_fadvise / PrefetchVirtualMemory)
+enum class PackageAccess {
+	Normal,
+	Sequential,
+	Random,	// Assets are loaded by GUID in any order, disables read-ahead of unrelated data
+	WillNeed	// Start reading the range in the background
+};
+
+// Read-only view of a whole package file, unmapped when the last owner releases it
+struct PackageMapping;
+
+// Read-only OS file handle of a mounted package
+// Reads are positional (pread / ReadFile with an OVERLAPPED offset), so the handle has no shared
+// cursor and any number of threads can read from it at once without locking
+// The file can also be mapped into memory, assets are then read straight from the mapping
+class PackageFile
+{
+private:
+#ifdef _WIN32
+	void* _handle = nullptr;	// HANDLE, kept as void* so Windows.h stays out of the header
+#else
+	int _handle = -1;
+#endif
+	uint64_t _size = 0;
+
+	std::shared_ptr<PackageMapping> _mapping;
+	const char* _mappedData = nullptr;
+
+public:
+	PackageFile() = default;
+	~PackageFile();
+
+	PackageFile(const PackageFile&) = delete;
+	PackageFile& operator=(const PackageFile&) = delete;
+	PackageFile(PackageFile&& other) noexcept;
+	PackageFile& operator=(PackageFile&& other) noexcept;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	// Reads size bytes starting at offset into buffer, fails if fewer bytes could be read
+	bool ReadAt(uint64_t offset, void* buffer, uint64_t size) const;
+
+	// Maps the whole file read-only, the mapping is released by Close()
+	// or when the last view handed out through GetMappingOwner() is gone
+	bool Map();
+
+	// Hint for how a range of the file will be read, ignored where the OS has no equivalent
+	void Advise(uint64_t offset, uint64_t size, PackageAccess access) const;
+
+	bool IsOpen() const;
+	bool IsMapped() const {
+		return _mappedData != nullptr;
+	}
+	// Start of the mapped file (nullptr if not mapped)
+	const char* GetMappedData() const {
+		return _mappedData;
+	}
+	// Shared ownership of the mapping, keeps views valid after the package is unmounted
+	std::shared_ptr<const void> GetMappingOwner() const;
+	uint64_t GetSize() const {
+		return _size;
+	}
+#ifndef _WIN32
+	// File descriptor for reads submitted to the kernel directly (io_uring)
+	int GetDescriptor() const {
+		return _handle;
+	}
+#endif
+};
@@ -2,51 +2,637 @@
 #include <filesystem>
 #include "GuidUtils.h"
 #include "Settings.h"
+#include "HeapTracking.h"
+#include "PackageCompression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 
-bool PackageManager::LoadAsset(MountedPackage& mountedPackage, const TOCEntry& tocEntry, AssetData& asset)
-{
-	// Read compressed data into a buffer
-	std::ifstream file(mountedPackage.path, std::ios::binary);
-	if (!file) {
-		std::cerr << "PackageManager::LoadAsset(): Could not open package file" << std::endl;
-		return false;
+namespace {
+	// Checks the signature and revision of a package read from disk
+	bool CheckHeader(const PackageHeader& header, const char* caller)
+	{
+		if (std::memcmp(header.signature, SIGNATURE, 5) != 0) {
+			std::cerr << caller << ": Signature does not match" << std::endl;
+			return false;
+		}
+
+		if (std::memcmp(header.signature, SIGNATURE, sizeof(header.signature)) != 0 || header.revision != PACKAGE_REVISION) {
+			std::cerr << caller << ": Package was made by an older version of the package manager, it has to be packed again" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	// FNV-1a hash of a key, used by the key index of the table of contents (stored in package files, must not change)
+	uint32_t HashKey(std::string_view key)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : key) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Scratch buffers above this size are released after use so one large asset does not keep its memory
+	constexpr size_t MAX_KEPT_SCRATCH_SIZE = 16 * 1024 * 1024;
+
+	// Compressed bytes of streamed packages are read into a per thread buffer that is reused between loads
+	std::vector<char>& GetScratchBuffer(size_t size)
+	{
+		thread_local std::vector<char> scratch;
+		if (scratch.size() < size) {
+			scratch.resize(size);
+		}
+		return scratch;
+	}
+
+	void ReleaseScratchBuffer(std::vector<char>& scratch)
+	{
+		if (scratch.size() > MAX_KEPT_SCRATCH_SIZE) {
+			std::vector<char>().swap(scratch);
+		}
+	}
+
+	// Reads the keys of a layout manifest, mapped to their position in the manifest
+	bool ReadLayoutManifest(const std::string& path, std::unordered_map<std::string, size_t>& order)
+	{
+		std::ifstream in(path);
+		if (!in) {
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			order.emplace(line, order.size());
+		}
+		return true;
+	}
+
+	// Identifies the content of an entry for deduplication (xxHash64 style rounds, not cryptographic)
+	uint64_t HashContent(const char* data, uint64_t size)
+	{
+		constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+
+		uint64_t hash = size * PRIME1;
+		uint64_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, sizeof(word));
+			hash ^= word * PRIME2;
+			hash = (hash << 31 | hash >> 33) * PRIME1;
+		}
+		for (; i < size; i++) {
+			hash ^= static_cast<uint8_t>(data[i]) * PRIME1;
+			hash = (hash << 11 | hash >> 53) * PRIME2;
+		}
+
+		// Final avalanche
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB93FE53E87A9ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// Hash of the paths, sizes and write times of the files Pack includes and their .meta files (they hold the GUIDs)
+	// Returns nothing if any of them could not be read, the package is then treated as out of date
+	std::optional<uint64_t> HashSourceManifest(const fs::path& sourcePath)
+	{
+		std::vector<std::pair<std::string, std::pair<uint64_t, int64_t>>> files;
+		std::error_code error;
+		auto addFile = [&](const fs::path& path) {
+			uint64_t size = fs::file_size(path, error);
+			if (error) {
+				return false;
+			}
+			int64_t writeTime = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+			if (error) {
+				return false;
+			}
+			files.emplace_back(path.lexically_relative(sourcePath).generic_string(), std::make_pair(size, writeTime));
+			return true;
+		};
+
+		fs::recursive_directory_iterator it(sourcePath, error);
+		for (; !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+			bool regular = it->is_regular_file(error);
+			if (error) {
+				return std::nullopt;
+			}
+			if (!regular || it->path().extension() == ".meta") {
+				continue;
+			}
+			if (!addFile(it->path())) {
+				return std::nullopt;
+			}
+
+			// A missing .meta file only leaves its entry out, Pack generates a new GUID for it
+			fs::path metaPath = it->path();
+			metaPath += ".meta";
+			bool hasMeta = fs::exists(metaPath, error);
+			if (error || (hasMeta && !addFile(metaPath))) {
+				return std::nullopt;
+			}
+		}
+		if (error) {
+			return std::nullopt;
+		}
+		std::sort(files.begin(), files.end());
+
+		std::string manifest;
+		for (const auto& [key, state] : files) {
+			manifest += key;
+			manifest += '\0';
+			manifest.append(reinterpret_cast<const char*>(&state.first), sizeof(state.first));
+			manifest.append(reinterpret_cast<const char*>(&state.second), sizeof(state.second));
+		}
+		return HashContent(manifest.data(), manifest.size());
+	}
+
+	// Size, last write time and content hash of a packed file
+	// Cached next to the package, tells which files probably did not change before they are compared
+	struct SourceState {
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		uint64_t contentHash = 0;
+	};
+
+	// Reads the states cached by the last pack (without a cache every file is read and hashed)
+	void ReadSourceCache(const std::string& path, std::unordered_map<std::string, SourceState>& cache)
+	{
+		std::ifstream in(path);
+		std::string line;
+		while (std::getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+
+			// size, write time, hash and key separated by tabs (the key last, it may contain spaces)
+			std::istringstream fields(line);
+			SourceState state;
+			std::string key;
+			if (fields >> state.size >> state.writeTime >> state.contentHash && fields.get() == '\t' && std::getline(fields, key)) {
+				cache[key] = state;
+			}
+		}
+	}
+
+	bool WriteSourceCache(const std::string& path, const std::vector<std::pair<std::string, SourceState>>& states)
+	{
+		std::ofstream out(path);
+		out << "# Source files of the package: size, last write time, content hash and key" << std::endl;
+		for (const auto& [key, state] : states) {
+			out << state.size << '\t' << state.writeTime << '\t' << state.contentHash << '\t' << key << '\n';
+		}
+		return out.good();
+	}
+
+	// A file of a package being packed, filled in by a compression worker and consumed by the writer
+	struct PackJob {
+		fs::path path;
+		std::string key;
+		std::string guid;
+		std::unique_ptr<char[]> compressedData; // Bytes to write (the file itself for stored entries)
+		PackageEntry packageEntry = {};
+		SourceState source;
+		bool hashKnown = false; // source.contentHash is taken from the cache (the file is still compared before an entry is reused)
+		const PackageTOCEntry* previousEntry = nullptr; // Entry of the file in the previous version of the package
+		const PackageTOCEntry* baseEntry = nullptr; // Entry of the file in the base package of a patch
+		bool reused = false; // Stored bytes copied from the previous package
+		bool unchanged = false; // Same content as in the base package, left out of the patch
+		bool done = false;
+		bool failed = false;
+	};
+
+	bool SameContent(const PackageTOCEntry* tocEntry, const SourceState& source)
+	{
+		return tocEntry && tocEntry->packageEntry.contentHash == source.contentHash && tocEntry->packageEntry.size == source.size;
+	}
+
+	// Decodes an entry of an existing package and compares it with a file, hashes alone can collide
+	bool EntryHoldsContent(const MountedPackage& package, const PackageTOCEntry& tocEntry, const char* data, uint64_t size)
+	{
+		const PackageEntry& packageEntry = tocEntry.packageEntry;
+		if (packageEntry.size != size) {
+			return false;
+		}
+
+		std::unique_ptr<char[]> stored = std::make_unique<char[]>(packageEntry.sizeCompressed);
+		std::unique_ptr<char[]> content = std::make_unique<char[]>(size);
+		if (!package.file.ReadAt(packageEntry.offset, stored.get(), packageEntry.sizeCompressed) ||
+			!PackageCompression::Decode(packageEntry, stored.get(), content.get(), package.dictionary)) {
+			return false;
+		}
+		return std::memcmp(content.get(), data, size) == 0;
+	}
+
+	// Reads, compresses and gets the GUID of one file (runs on a compression worker)
+	// Files whose content did not change since the previous package are copied from it instead of being compressed again
+	bool CompressPackJob(PackJob& job, const PackageDictionary& dictionary, const MountedPackage* previous, const MountedPackage* base)
+	{
+		if (!GuidUtils::GetOrGenerateGuid(job.path, job.guid)) {
+			std::cerr << "PackageManager::Pack(): Could not get or generate GUID for " << job.path << std::endl;
+		}
+		job.guid.resize(GUID_STR_LENGTH); // The TOC stores fixed size GUIDs
+
+		std::unique_ptr<char[]> data;
+		auto readFile = [&]() {
+			std::ifstream in(job.path, std::ios::binary);
+			if (!in) {
+				std::cerr << "PackageManager::Pack(): Could not read file " << job.path << std::endl;
+				return false;
+			}
+
+			in.seekg(0, std::ios::end); // Set cursor to end of file
+			job.source.size = static_cast<uint64_t>(in.tellg()); // Get cursor pos
+			in.seekg(0, std::ios::beg); // Reset curosr to start of file
+			data = std::make_unique<char[]>(job.source.size);
+			in.read(data.get(), job.source.size); // Filling the buffer with file contents
+			job.source.contentHash = HashContent(data.get(), job.source.size);
+			return true;
+		};
+
+		if (!job.hashKnown && !readFile()) {
+			return false;
+		}
+
+		// The cache can be stale, a file that seems unchanged is read and compared before its old entry is taken
+		if (!data && (SameContent(job.baseEntry, job.source) || SameContent(job.previousEntry, job.source)) && !readFile()) {
+			return false;
+		}
+
+		if (SameContent(job.baseEntry, job.source) && EntryHoldsContent(*base, *job.baseEntry, data.get(), job.source.size)) {
+			job.unchanged = true;
+			return true;
+		}
+
+		if (SameContent(job.previousEntry, job.source) && EntryHoldsContent(*previous, *job.previousEntry, data.get(), job.source.size)) {
+			const PackageEntry& previousEntry = job.previousEntry->packageEntry;
+			job.compressedData = std::make_unique<char[]>(previousEntry.sizeCompressed);
+			if (!previous->file.ReadAt(previousEntry.offset, job.compressedData.get(), previousEntry.sizeCompressed)) {
+				std::cerr << "PackageManager::Pack(): Could not copy " << job.key << " from the previous package" << std::endl;
+				return false;
+			}
+			job.packageEntry = previousEntry;
+			job.reused = true;
+			return true;
+		}
+
+		// Cached hash but the content has to be compressed after all (e.g. the file is new to the package)
+		if (!data && !readFile()) {
+			return false;
+		}
+
+		// Compressing file
+		std::string extension = job.path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		job.compressedData = std::move(data);
+		if (!PackageCompression::Compress(job.compressedData, job.source.size, extension, dictionary, job.packageEntry)) {
+			std::cerr << "PackageManager::Pack(): Compression error for " << job.key << std::endl;
+			return false;
+		}
+		job.packageEntry.contentHash = job.source.contentHash;
+
+		return true;
 	}
+}
 
-	AssetData compressedData;
-	compressedData.size = tocEntry.packageEntry.sizeCompressed;
-	compressedData.data = std::make_unique<char[]>(tocEntry.packageEntry.sizeCompressed);
+bool PackageManager::LoadAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, AssetData& asset)
+{
+	HeapTagScope heapScope("Package load");
+
+	// Stored entries of mapped packages are returned as views, no copy
+	const PackageFile& file = mountedPackage.file;
+	const PackageEntry& packageEntry = tocEntry.packageEntry;
+	if (file.IsMapped() && packageEntry.codec == PackageCodec::Store) {
+		if (packageEntry.offset > file.GetSize() || packageEntry.size > file.GetSize() - packageEntry.offset) {
+			std::cerr << "PackageManager::LoadAsset(): Entry " << mountedPackage.GetKey(tocEntry) << " lies outside of the package file" << std::endl;
+			return false;
+		}
 
-	file.clear(); // Resets read if EOF has been hit
-	file.seekg(tocEntry.packageEntry.offset);
-	file.read(compressedData.data.get(), compressedData.size);
+		AssetData view;
+		view.size = packageEntry.size;
+		view.view = file.GetMappedData() + packageEntry.offset;
+		view.viewOwner = file.GetMappingOwner();
+		view.fileExtension = fs::path(mountedPackage.GetKey(tocEntry)).extension().string();
+		asset = std::move(view);
+		return true;
+	}
 
-	// Decompress data from buffer
 	AssetData uncompressedData;
 	uncompressedData.size = tocEntry.packageEntry.size;
 	uncompressedData.data = std::make_unique<char[]>(tocEntry.packageEntry.size);
 
-	int uncompressedSize = LZ4_decompress_safe(
-		compressedData.data.get(),
-		uncompressedData.data.get(),
-		static_cast<int>(compressedData.size),
-		static_cast<int>(uncompressedData.size)
-	);
+	if (!ReadAsset(mountedPackage, tocEntry, uncompressedData.data.get())) {
+		return false;
+	}
+
+	uncompressedData.fileExtension = fs::path(mountedPackage.GetKey(tocEntry)).extension().string();
+	asset = std::move(uncompressedData);
+
+	return true;
+}
+
+bool PackageManager::ReadAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, char* destination)
+{
+	const PackageEntry& packageEntry = tocEntry.packageEntry;
+	const PackageFile& file = mountedPackage.file;
+
+	if (packageEntry.offset > file.GetSize() || packageEntry.sizeCompressed > file.GetSize() - packageEntry.offset) {
+		std::cerr << "PackageManager::ReadAsset(): Entry " << mountedPackage.GetKey(tocEntry) << " lies outside of the package file" << std::endl;
+		return false;
+	}
+
+	const char* compressed = nullptr;
+	std::vector<char>* scratch = nullptr;
+	if (file.IsMapped()) {
+		// Decompress straight from the mapping
+		compressed = file.GetMappedData() + packageEntry.offset;
+	}
+	else if (packageEntry.codec == PackageCodec::Store) {
+		// Stored entries are read straight into the destination
+		if (!file.ReadAt(packageEntry.offset, destination, packageEntry.size)) {
+			std::cerr << "PackageManager::ReadAsset(): Could not read " << mountedPackage.GetKey(tocEntry) << " from package file" << std::endl;
+			return false;
+		}
+		return true;
+	}
+	else {
+		// Read compressed data into the scratch buffer (positional read, no seek state shared with other threads)
+		scratch = &GetScratchBuffer(packageEntry.sizeCompressed);
+		if (!file.ReadAt(packageEntry.offset, scratch->data(), packageEntry.sizeCompressed)) {
+			std::cerr << "PackageManager::ReadAsset(): Could not read " << mountedPackage.GetKey(tocEntry) << " from package file" << std::endl;
+			return false;
+		}
+		compressed = scratch->data();
+	}
+
+	bool decoded = PackageCompression::Decode(packageEntry, compressed, destination, mountedPackage.dictionary);
+
+	if (scratch) {
+		ReleaseScratchBuffer(*scratch);
+	}
+
+	if (!decoded) {
+		std::cerr << "PackageManager::ReadAsset(): Decompression failed for " << mountedPackage.GetKey(tocEntry) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool PackageManager::DecodeAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, const char* source, AssetData& asset)
+{
+	const PackageEntry& packageEntry = tocEntry.packageEntry;
+
+	AssetData uncompressedData;
+	uncompressedData.size = packageEntry.size;
+	uncompressedData.data = std::make_unique<char[]>(packageEntry.size);
 
-	if (uncompressedSize < 0) {
-		std::cerr << "PackageManager::LoadAsset(): Decompression failed" << std::endl;
+	if (packageEntry.codec == PackageCodec::Store) {
+		std::memcpy(uncompressedData.data.get(), source, packageEntry.size);
+	}
+	else if (!PackageCompression::Decode(packageEntry, source, uncompressedData.data.get(), mountedPackage.dictionary)) {
+		std::cerr << "PackageManager::DecodeAsset(): Decompression failed for " << mountedPackage.GetKey(tocEntry) << std::endl;
 		return false;
 	}
 
-	uncompressedData.fileExtension = fs::path(tocEntry.key).extension().string();
+	uncompressedData.fileExtension = fs::path(mountedPackage.GetKey(tocEntry)).extension().string();
 	asset = std::move(uncompressedData);
 
 	return true;
 }
 
-bool PackageManager::Pack(const std::string& source, const std::string& target)
+bool PackageManager::ReadAssetRange(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, uint64_t offset, uint64_t size, char* destination)
+{
+	const PackageEntry& packageEntry = tocEntry.packageEntry;
+	const PackageFile& file = mountedPackage.file;
+
+	if (offset > packageEntry.size || size > packageEntry.size - offset) {
+		std::cerr << "PackageManager::ReadAssetRange(): Range lies outside of " << mountedPackage.GetKey(tocEntry) << std::endl;
+		return false;
+	}
+
+	if (packageEntry.offset > file.GetSize() || packageEntry.sizeCompressed > file.GetSize() - packageEntry.offset) {
+		std::cerr << "PackageManager::ReadAssetRange(): Entry " << mountedPackage.GetKey(tocEntry) << " lies outside of the package file" << std::endl;
+		return false;
+	}
+
+	if (size == 0) {
+		return true;
+	}
+
+	// Stored entries are read directly
+	if (packageEntry.codec == PackageCodec::Store) {
+		if (file.IsMapped()) {
+			std::memcpy(destination, file.GetMappedData() + packageEntry.offset + offset, size);
+			return true;
+		}
+		return file.ReadAt(packageEntry.offset + offset, destination, size);
+	}
+
+	// Single blocks have to be decompressed as a whole
+	if (packageEntry.chunkCount == 0) {
+		std::vector<char> asset(packageEntry.size);
+		if (!ReadAsset(mountedPackage, tocEntry, asset.data())) {
+			return false;
+		}
+		std::memcpy(destination, asset.data() + offset, size);
+		return true;
+	}
+
+	// Chunk table, only read once it is known to lie inside the entry
+	if (!PackageCompression::HasValidChunkLayout(packageEntry)) {
+		std::cerr << "PackageManager::ReadAssetRange(): Entry " << mountedPackage.GetKey(tocEntry) << " has an invalid chunk layout" << std::endl;
+		return false;
+	}
+
+	std::vector<uint64_t> offsets;
+	std::vector<char> table;
+	const char* tableData = nullptr;
+	if (file.IsMapped()) {
+		tableData = file.GetMappedData() + packageEntry.offset;
+	}
+	else {
+		table.resize(PackageCompression::GetChunkTableSize(packageEntry));
+		if (!file.ReadAt(packageEntry.offset, table.data(), table.size())) {
+			std::cerr << "PackageManager::ReadAssetRange(): Could not read chunk table of " << mountedPackage.GetKey(tocEntry) << std::endl;
+			return false;
+		}
+		tableData = table.data();
+	}
+	if (!PackageCompression::ReadChunkTable(packageEntry, tableData, offsets)) {
+		return false;
+	}
+
+	// Only the chunks holding the range are read
+	uint32_t first = static_cast<uint32_t>(offset / packageEntry.chunkSize);
+	uint32_t last = static_cast<uint32_t>((offset + size + packageEntry.chunkSize - 1) / packageEntry.chunkSize);
+	uint64_t storedSize = offsets[last] - offsets[first];
+
+	const char* stored = nullptr;
+	std::vector<char>* scratch = nullptr;
+	if (file.IsMapped()) {
+		stored = file.GetMappedData() + packageEntry.offset + offsets[first];
+	}
+	else {
+		scratch = &GetScratchBuffer(storedSize);
+		if (!file.ReadAt(packageEntry.offset + offsets[first], scratch->data(), storedSize)) {
+			std::cerr << "PackageManager::ReadAssetRange(): Could not read " << mountedPackage.GetKey(tocEntry) << " from package file" << std::endl;
+			return false;
+		}
+		stored = scratch->data();
+	}
+
+	// Chunk aligned ranges are decoded straight into the destination
+	uint64_t rangeStart = static_cast<uint64_t>(first) * packageEntry.chunkSize;
+	uint64_t rangeEnd = std::min<uint64_t>(static_cast<uint64_t>(last) * packageEntry.chunkSize, packageEntry.size);
+	bool decoded = false;
+	if (rangeStart == offset && rangeEnd == offset + size) {
+		decoded = PackageCompression::DecodeChunks(packageEntry, offsets, first, last, stored, destination);
+	}
+	else {
+		std::vector<char> chunks(rangeEnd - rangeStart);
+		decoded = PackageCompression::DecodeChunks(packageEntry, offsets, first, last, stored, chunks.data());
+		if (decoded) {
+			std::memcpy(destination, chunks.data() + (offset - rangeStart), size);
+		}
+	}
+
+	if (scratch) {
+		ReleaseScratchBuffer(*scratch);
+	}
+
+	if (!decoded) {
+		std::cerr << "PackageManager::ReadAssetRange(): Decompression failed for " << mountedPackage.GetKey(tocEntry) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+const PackageTOCEntry* MountedPackage::FindByGuid(const PackageGuid& guid) const
+{
+	const PackageTOCEntry* end = entries + entryCount;
+	const PackageTOCEntry* entry = std::lower_bound(entries, end, guid,
+		[](const PackageTOCEntry& entry, const PackageGuid& guid) { return entry.guid < guid; });
+	return entry != end && entry->guid == guid ? entry : nullptr;
+}
+
+const PackageTOCEntry* MountedPackage::FindByKey(std::string_view key) const
+{
+	if (keyIndexSize == 0) {
+		return nullptr;
+	}
+
+	// Linear probing, the index is at most half full
+	uint32_t mask = keyIndexSize - 1;
+	for (uint32_t slot = HashKey(key) & mask; keyIndex[slot] != 0; slot = (slot + 1) & mask) {
+		const PackageTOCEntry& entry = entries[keyIndex[slot] - 1];
+		if (GetKey(entry) == key) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+bool PackageManager::FindAssetByGuid(const std::string& guid, const MountedPackage*& mountedPackage, const PackageTOCEntry*& tocEntry) const
+{
+	PackageGuid binaryGuid;
+	if (!GuidUtils::ParseGuid(guid, binaryGuid.bytes)) {
+		return false;
+	}
+
+	auto location = _guidIndex.find(binaryGuid);
+	if (location == _guidIndex.end()) {
+		return false;
+	}
+
+	mountedPackage = location->second.package;
+	tocEntry = location->second.entry;
+	return true;
+}
+
+void PackageManager::AddToIndex(const MountedPackage& mountedPackage)
 {
+	_guidIndex.reserve(_guidIndex.size() + mountedPackage.entryCount);
+	_keyIndex.reserve(_keyIndex.size() + mountedPackage.entryCount);
+
+	// Mounted last, so its assets replace the ones of all other packages
+	for (uint32_t i = 0; i < mountedPackage.entryCount; i++) {
+		const PackageTOCEntry& entry = mountedPackage.entries[i];
+		AssetLocation location = { &mountedPackage, &entry };
+		_guidIndex.insert_or_assign(entry.guid, location);
+
+		// Replaced together with its key, which has to point into the table of contents of this package
+		std::string_view key = mountedPackage.GetKey(entry);
+		_keyIndex.erase(key);
+		_keyIndex.emplace(key, location);
+	}
+}
+
+void PackageManager::RemoveFromIndex(const MountedPackage& mountedPackage)
+{
+	for (uint32_t i = 0; i < mountedPackage.entryCount; i++) {
+		const PackageTOCEntry& entry = mountedPackage.entries[i];
+		std::string_view key = mountedPackage.GetKey(entry);
+
+		// Assets that are overridden by another package are left as they are
+		auto guidLocation = _guidIndex.find(entry.guid);
+		if (guidLocation != _guidIndex.end() && guidLocation->second.package == &mountedPackage) {
+			_guidIndex.erase(guidLocation);
+			for (size_t j = _mountOrder.size(); j != 0; --j) {
+				const MountedPackage& package = _mountedPackages.find(_mountOrder[j - 1])->second;
+				const PackageTOCEntry* fallback = package.FindByGuid(entry.guid);
+				if (fallback) {
+					_guidIndex.emplace(entry.guid, AssetLocation{ &package, fallback });
+					break;
+				}
+			}
+		}
+
+		// Erased before searching, the key it holds points into the table of contents of the package
+		auto keyLocation = _keyIndex.find(key);
+		if (keyLocation != _keyIndex.end() && keyLocation->second.package == &mountedPackage) {
+			_keyIndex.erase(keyLocation);
+			for (size_t j = _mountOrder.size(); j != 0; --j) {
+				const MountedPackage& package = _mountedPackages.find(_mountOrder[j - 1])->second;
+				const PackageTOCEntry* fallback = package.FindByKey(key);
+				if (fallback) {
+					_keyIndex.emplace(package.GetKey(*fallback), AssetLocation{ &package, fallback });
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool PackageManager::Pack(const std::string& source, const std::string& target, const std::string& layoutManifest)
+{
+	HeapTagScope heapScope("Package pack");
+
 	fs::path sourcePath(source);
 	fs::path targetPath(target);
 
@@ -65,8 +651,152 @@ bool PackageManager::Pack(const std::string& source, const std::string& target)
 	std::string packageName = sourcePath.stem().generic_string() + ".gepak";
 	targetPath = targetPath / packageName;
 
+	// An existing package is packed again incrementally, files that did not change are copied from it
+	std::unique_ptr<MountedPackage> previous;
+	if (fs::is_regular_file(targetPath)) {
+		PackageHeader existing = {};
+		std::ifstream existingFile(targetPath, std::ios::binary);
+		existingFile.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+		std::streamsize headerBytes = existingFile.gcount();
+		existingFile.close();
+
+		if (headerBytes < 5 || std::memcmp(existing.signature, SIGNATURE, 5) != 0) {
+			std::cerr << "PackageManager::Pack(): A file that is not a package already exists in target directory" << std::endl;
+			return false;
+		}
+
+		// Packages made by an older version of the package manager are rebuilt from scratch
+		bool current = std::memcmp(existing.signature, SIGNATURE, sizeof(existing.signature)) == 0 && existing.revision == PACKAGE_REVISION;
+		if (!current) {
+			std::cout << "PackageManager::Pack(): Rebuilding outdated package " << packageName << std::endl;
+		}
+		else if (layoutManifest.empty() && existing.sourceManifestHash == HashSourceManifest(sourcePath)) {
+			return true; // Nothing changed since the package was written (a layout manifest always reorders the package)
+		}
+		else {
+			previous = std::make_unique<MountedPackage>();
+			if (!OpenPackage(targetPath.string(), PackageMountMode::Stream, *previous, "PackageManager::Pack()")) {
+				std::cout << "PackageManager::Pack(): Rebuilding damaged package " << packageName << std::endl;
+				previous.reset();
+			}
+		}
+	}
+
+	// Written next to the package and swapped in once complete, the previous package is read while packing
+	fs::path temporaryPath = targetPath;
+	temporaryPath += ".tmp";
+
+	std::string cache = targetPath.string() + ".cache";
+	bool packed = WritePackage(source, temporaryPath.string(), layoutManifest, previous.get(), nullptr, cache, cache);
+	previous.reset();
+	if (!packed) {
+		return false;
+	}
+
+	std::error_code error;
+	fs::rename(temporaryPath, targetPath, error);
+	if (error) {
+		std::cerr << "PackageManager::Pack(): Could not replace " << packageName << " (" << error.message() << ")" << std::endl;
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool PackageManager::PackPatch(const std::string& source, const std::string& basePackage, const std::string& target)
+{
+	HeapTagScope heapScope("Package pack");
+
+	fs::path sourcePath(source);
+	fs::path targetPath(target);
+
+	// Path validity checks
+	if (!fs::is_directory(sourcePath)) {
+		std::cerr << "PackageManager::PackPatch(): Source is not a directory" << std::endl;
+		return false;
+	}
+
+	if (!fs::is_directory(targetPath)) {
+		std::cerr << "PackageManager::PackPatch(): Target is not a directory" << std::endl;
+		return false;
+	}
+
+	MountedPackage base;
+	if (!OpenPackage(basePackage, PackageMountMode::Stream, base, "PackageManager::PackPatch()")) {
+		return false;
+	}
+
+	// Patches only depend on the source and the base package, an existing patch is replaced
+	std::string patchName = sourcePath.stem().generic_string() + "_patch.gepak";
+	targetPath = targetPath / patchName;
 	if (fs::is_regular_file(targetPath)) {
-		std::cerr << "PackageManager::Pack(): Package already exists in target directory" << std::endl;
+		PackageHeader existing = {};
+		std::ifstream existingFile(targetPath, std::ios::binary);
+		existingFile.read(reinterpret_cast<char*>(&existing), sizeof(existing));
+		std::streamsize headerBytes = existingFile.gcount();
+		existingFile.close();
+
+		if (headerBytes < 5 || std::memcmp(existing.signature, SIGNATURE, 5) != 0) {
+			std::cerr << "PackageManager::PackPatch(): A file that is not a package already exists in target directory" << std::endl;
+			return false;
+		}
+	}
+
+	// Written next to the patch and swapped in once complete, a failed build keeps the existing patch
+	fs::path temporaryPath = targetPath;
+	temporaryPath += ".tmp";
+
+	// The cache of the base package tells which files probably did not change, it is only read
+	if (!WritePackage(source, temporaryPath.string(), "", nullptr, &base, basePackage + ".cache", targetPath.string() + ".cache")) {
+		return false;
+	}
+
+	std::error_code error;
+	fs::rename(temporaryPath, targetPath, error);
+	if (error) {
+		std::cerr << "PackageManager::PackPatch(): Could not replace " << patchName << " (" << error.message() << ")" << std::endl;
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool PackageManager::IsPackageUpToDate(const std::string& source, const std::string& package) const
+{
+	PackageHeader header = {};
+	std::ifstream packageFile(package, std::ios::binary);
+	packageFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (packageFile.gcount() != sizeof(header) || std::memcmp(header.signature, SIGNATURE, sizeof(header.signature)) != 0 ||
+		header.revision != PACKAGE_REVISION) {
+		return false;
+	}
+
+	// Without sources (shipped build) the package can't be rebuilt, so it is the newest there is
+	fs::path sourcePath(source);
+	std::error_code error;
+	if (!fs::is_directory(sourcePath, error)) {
+		return !error;
+	}
+
+	std::optional<uint64_t> manifestHash = HashSourceManifest(sourcePath);
+	return manifestHash && header.sourceManifestHash == *manifestHash;
+}
+
+bool PackageManager::WritePackage(const std::string& source, const std::string& packagePath, const std::string& layoutManifest,
+	const MountedPackage* previous, const MountedPackage* base, const std::string& sourceCache, const std::string& targetCache)
+{
+	fs::path sourcePath(source);
+	fs::path targetPath(packagePath);
+	std::string packageName = targetPath.filename().generic_string();
+	if (targetPath.extension() == ".tmp") {
+		packageName = targetPath.stem().generic_string(); // Temporary file of Pack, named after the package it replaces
+	}
+
+	std::unordered_map<std::string, size_t> layoutOrder;
+	if (!layoutManifest.empty() && !ReadLayoutManifest(layoutManifest, layoutOrder)) {
+		std::cerr << "PackageManager::Pack(): Could not read layout manifest " << layoutManifest << std::endl;
 		return false;
 	}
 
@@ -81,13 +811,15 @@ bool PackageManager::Pack(const std::string& source, const std::string& target)
 	out.seekp(sizeof(PackageHeader));
 
 	// Table of contents (To be written at the back of the package)
-	std::vector<TOCEntry> toc;
+	std::vector<PackageTOCEntry> toc;
+	std::string keyStrings;
 
 #ifdef DEBUG
 		std::cout << "Starting packing: " << packageName << std::endl;
 #endif
 
-	// Packaging directory
+	// Collecting files, sorted by key so the package layout does not depend on directory iteration order
+	std::vector<PackJob> jobs;
 	for (const auto& dirEntry : fs::recursive_directory_iterator(sourcePath)) {
 		if (fs::is_regular_file(dirEntry)) {
 			fs::path entryPath = dirEntry.path();
@@ -97,82 +829,390 @@ bool PackageManager::Pack(const std::string& source, const std::string& target)
 				continue;
 			}
 
-			fs::path relativePath = fs::relative(entryPath, sourcePath); // Relative path for TOC entry
-			std::string key = relativePath.generic_string();
+			PackJob job;
+			job.path = entryPath;
+			job.key = fs::relative(entryPath, sourcePath).generic_string(); // Relative path for TOC entry
 
-			// Read file
-			std::ifstream in(entryPath, std::ios::binary);
-			if (!in) {
-				std::cerr << "PackageManager::Pack(): Could not read file" << std::endl;
-				return false;
+			// New files get their .meta file before the source manifest is hashed
+			fs::path metaPath = entryPath;
+			metaPath += ".meta";
+			if (!fs::exists(metaPath) && !GuidUtils::GetOrGenerateGuid(entryPath, job.guid)) {
+				std::cerr << "PackageManager::Pack(): Could not get or generate GUID for " << entryPath << std::endl;
 			}
 
-			AssetData uncompressedData;
-			in.seekg(0, std::ios::end); // Set cursor to end of file
-			uncompressedData.size = static_cast<uint64_t>(in.tellg()); // Get cursor pos
-			in.seekg(0, std::ios::beg); // Reset curosr to start of file
-			uncompressedData.data = std::make_unique<char[]>(uncompressedData.size);
-			in.read(uncompressedData.data.get(), uncompressedData.size); // Filling AssetData with file contents
+			std::error_code error;
+			job.source.size = fs::file_size(entryPath, error);
+			job.source.writeTime = static_cast<int64_t>(fs::last_write_time(entryPath, error).time_since_epoch().count());
+			jobs.push_back(std::move(job));
+		}
+	}
+	std::sort(jobs.begin(), jobs.end(), [](const PackJob& a, const PackJob& b) { return a.key < b.key; });
+
+	// Hashed before any file is read, a file changed while packing leaves the package out of date
+	// A manifest that could not be read is stored as 0, so the next check finds the package out of date
+	header.sourceManifestHash = HashSourceManifest(sourcePath).value_or(0);
+
+	// Files with the same size and write time as in the cache keep their content hash
+	std::unordered_map<std::string, SourceState> cache;
+	ReadSourceCache(sourceCache, cache);
+	for (PackJob& job : jobs) {
+		auto cached = cache.find(job.key);
+		if (cached != cache.end() && cached->second.size == job.source.size && cached->second.writeTime == job.source.writeTime) {
+			job.source.contentHash = cached->second.contentHash;
+			job.hashKnown = true;
+		}
+		job.previousEntry = previous ? previous->FindByKey(job.key) : nullptr;
+		job.baseEntry = base ? base->FindByKey(job.key) : nullptr;
+	}
+
+	// Shared dictionary for the small files, written right after the header
+	// Kept from the previous package, the entries copied from it were compressed with it
+	std::vector<std::string> files;
+	for (const PackJob& job : jobs) {
+		if (!(job.hashKnown && SameContent(job.baseEntry, job.source))) {
+			files.push_back(job.path.string());
+		}
+	}
 
-			AssetData compressedData;
-			int maxSizeCompressed = LZ4_compressBound(uncompressedData.size); // Maximum size the compressed version can reach
-			compressedData.data = std::make_unique<char[]>(maxSizeCompressed);
+	auto dictionary = std::make_unique<PackageDictionary>(); // Holds an LZ4 stream, too large for the stack
+	if (previous) {
+		PackageCompression::LoadDictionary(previous->dictionary, *dictionary);
+	}
+	else if (!PackageCompression::BuildDictionary(files, *dictionary)) {
+		std::cerr << "PackageManager::Pack(): Could not build dictionary" << std::endl;
+		out.close();
+		fs::remove(targetPath);
+		return false;
+	}
 
-			// Compressing file
-			int sizeCompressed = LZ4_compress_default(uncompressedData.data.get(), compressedData.data.get(), uncompressedData.size, maxSizeCompressed);
-			if (sizeCompressed == 0) {
-				std::cerr << "PackageManager::Pack(): Compression error" << std::endl;
-				return false;
+	// Files in the layout manifest are written first in first-use order, the rest stays sorted by key
+	// (after building the dictionary, so the manifest does not change it)
+	if (!layoutOrder.empty()) {
+		std::stable_sort(jobs.begin(), jobs.end(), [&layoutOrder](const PackJob& a, const PackJob& b) {
+			auto orderA = layoutOrder.find(a.key);
+			auto orderB = layoutOrder.find(b.key);
+			size_t positionA = orderA != layoutOrder.end() ? orderA->second : SIZE_MAX;
+			size_t positionB = orderB != layoutOrder.end() ? orderB->second : SIZE_MAX;
+			return positionA < positionB;
+		});
+	}
+
+	header.dictionaryOffset = static_cast<uint64_t>(out.tellp());
+	header.dictionarySize = dictionary->data.size();
+	out.write(dictionary->data.data(), dictionary->data.size());
+
+	// Compression workers take files in order, the writer (this thread) writes them in the same order
+	// Workers stay at most a window of files ahead of the writer to bound the memory held by compressed files
+	size_t threadCount = PACK_THREADS > 0 ? PACK_THREADS : std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, std::max<size_t>(jobs.size(), 1));
+	const size_t window = threadCount * 4;
+
+	std::mutex jobMutex;
+	std::condition_variable jobDone; // Signalled by workers when a job finished
+	std::condition_variable jobWritten; // Signalled by the writer when it moved on
+	size_t nextJob = 0;
+	size_t nextWrite = 0;
+	bool failed = false;
+
+	auto worker = [&]() {
+		HeapTagScope workerScope("Package pack");
+
+		while (true) {
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobWritten.wait(lock, [&] { return failed || nextJob >= jobs.size() || nextJob < nextWrite + window; });
+				if (failed || nextJob >= jobs.size()) {
+					return;
+				}
+				index = nextJob++;
 			}
-			compressedData.size = sizeCompressed; // Correct the size of the data buffer
 
-			TOCEntry entry;
-			if (!GuidUtils::GetOrGenerateGuid(entryPath, entry.guid)) {
-				std::cerr << "PackageManager::Pack(): Could not get or generate GUID for " << entryPath << std::endl;
+			bool success = CompressPackJob(jobs[index], *dictionary, previous, base);
+
+			{
+				std::lock_guard<std::mutex> lock(jobMutex);
+				jobs[index].done = true;
+				jobs[index].failed = !success;
 			}
-			entry.key = key;
+			jobDone.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threadCount; i++) {
+		workers.emplace_back(worker);
+	}
+
+	// Content already written to the package, files with the same content point at the first copy
+	std::unordered_multimap<uint64_t, PackageEntry> writtenContent;
+	std::ifstream writtenFile;
+
+	// Hashes can collide, a copy is only shared if its stored bytes are the same (read back from the package)
+	auto sameStoredBytes = [&](const PackageEntry& written, const PackJob& job) {
+		const PackageEntry& packageEntry = job.packageEntry;
+		if (written.size != packageEntry.size || written.sizeCompressed != packageEntry.sizeCompressed || written.codec != packageEntry.codec ||
+			written.chunkSize != packageEntry.chunkSize || written.chunkCount != packageEntry.chunkCount) {
+			return false;
+		}
+
+		out.flush();
+		if (!writtenFile.is_open()) {
+			writtenFile.open(targetPath, std::ios::binary);
+		}
+		writtenFile.clear();
+		writtenFile.seekg(written.offset);
+
+		std::unique_ptr<char[]> stored = std::make_unique<char[]>(written.sizeCompressed);
+		writtenFile.read(stored.get(), written.sizeCompressed);
+		return writtenFile && std::memcmp(stored.get(), job.compressedData.get(), written.sizeCompressed) == 0;
+	};
+	uint64_t deduplicatedBytes = 0;
+	size_t reusedCount = 0;
+	std::vector<std::pair<std::string, SourceState>> sourceStates;
+
+	bool packed = true;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		PackJob& job = jobs[i];
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobDone.wait(lock, [&] { return job.done; });
+		}
+
+		if (job.failed) {
+			packed = false;
+			break;
+		}
+
+		sourceStates.emplace_back(job.key, job.source);
+		if (!job.unchanged) {
+			reusedCount += job.reused ? 1 : 0;
+
+			PackageTOCEntry entry = {};
+			if (!GuidUtils::ParseGuid(job.guid, entry.guid.bytes)) {
+				std::cerr << "PackageManager::Pack(): Invalid GUID in meta file of " << job.key << std::endl;
+			}
+			entry.keyOffset = static_cast<uint32_t>(keyStrings.size());
+			entry.keyLength = static_cast<uint32_t>(job.key.size());
+			entry.packageEntry = job.packageEntry;
 			entry.packageEntry.offset = static_cast<uint64_t>(out.tellp());
-			entry.packageEntry.size = uncompressedData.size;
-			entry.packageEntry.sizeCompressed = static_cast<uint64_t>(sizeCompressed);
 
+			bool duplicate = false;
+			auto candidates = writtenContent.equal_range(job.packageEntry.contentHash);
+			for (auto written = candidates.first; written != candidates.second && !duplicate; ++written) {
+				if (sameStoredBytes(written->second, job)) {
+					// Same content as an earlier file, only a TOC entry is added
+					entry.packageEntry = written->second;
+					deduplicatedBytes += job.packageEntry.sizeCompressed;
+					duplicate = true;
+				}
+			}
+			if (!duplicate) {
+				// Write the compressed data to the output file
+				out.write(job.compressedData.get(), job.packageEntry.sizeCompressed);
+				writtenContent.emplace(job.packageEntry.contentHash, entry.packageEntry);
+			}
+			job.compressedData.reset();
+
+			keyStrings += job.key;
 			toc.push_back(entry);
-			
-			// Write the compressed data to the output file
-			out.write(compressedData.data.get(), compressedData.size);
 
 #ifdef DEBUG
-				std::cout << "Packed " << key << " (" << uncompressedData.size << " -> " << compressedData.size << " bytes)" << std::endl;
+			std::cout << "Packed " << job.key << " (" << job.packageEntry.size << " -> " << job.packageEntry.sizeCompressed << " bytes)" << std::endl;
 #endif
 		}
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			nextWrite = i + 1;
+		}
+		jobWritten.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		failed = !packed;
+	}
+	jobWritten.notify_all();
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+
+	if (!packed || !out) {
+		std::cerr << "PackageManager::Pack(): Packing " << packageName << " failed" << std::endl;
+		out.close();
+		fs::remove(targetPath);
+		return false;
+	}
+
+	if (deduplicatedBytes > 0) {
+		std::cout << "PackageManager::Pack(): " << toc.size() - writtenContent.size() << " duplicate files in " << packageName
+			<< " share stored data (" << deduplicatedBytes << " bytes saved)" << std::endl;
+	}
+	if (previous) {
+		std::cout << "PackageManager::Pack(): Copied " << reusedCount << " of " << toc.size() << " entries of " << packageName << " from the previous package" << std::endl;
+	}
+	if (base) {
+		std::cout << "PackageManager::PackPatch(): " << toc.size() << " of " << jobs.size() << " files changed, written to " << packageName << std::endl;
+	}
+
+	if (!WriteSourceCache(targetCache, sourceStates)) {
+		std::cerr << "PackageManager::Pack(): Could not write source cache " << targetCache << std::endl;
+	}
+
+	// Table of contents: entries sorted by GUID for binary search, then the key index and the key strings
+	std::sort(toc.begin(), toc.end(), [](const PackageTOCEntry& a, const PackageTOCEntry& b) { return a.guid < b.guid; });
+	for (size_t i = 1; i < toc.size(); i++) {
+		if (toc[i].guid == toc[i - 1].guid) {
+			std::cerr << "PackageManager::Pack(): Duplicate GUID " << GuidUtils::FormatGuid(toc[i].guid.bytes) << " in " << packageName << std::endl;
+		}
+	}
+
+	uint32_t keyIndexSize = 0;
+	if (!toc.empty()) {
+		keyIndexSize = 1;
+		while (keyIndexSize < toc.size() * 2) {
+			keyIndexSize *= 2;
+		}
+	}
+	std::vector<uint32_t> keyIndex(keyIndexSize, 0);
+	for (uint32_t i = 0; i < toc.size(); i++) {
+		std::string_view key(keyStrings.data() + toc[i].keyOffset, toc[i].keyLength);
+		uint32_t slot = HashKey(key) & (keyIndexSize - 1);
+		while (keyIndex[slot] != 0) {
+			slot = (slot + 1) & (keyIndexSize - 1);
+		}
+		keyIndex[slot] = i + 1;
+	}
+
+	// Aligned so the entries can be used in place when the package is mapped
+	uint64_t dataEnd = static_cast<uint64_t>(out.tellp());
+	uint64_t padding = (8 - dataEnd % 8) % 8;
+	out.write("\0\0\0\0\0\0\0", padding);
+
+	// Finalizing header
+	header.tableOfContentsOffset = dataEnd + padding; // Recording starting offset for the TOC
+	header.tableOfContentsSize = toc.size() * sizeof(PackageTOCEntry) + keyIndex.size() * sizeof(uint32_t) + keyStrings.size();
+	header.AssetCount = static_cast<uint32_t>(toc.size());
+	header.keyIndexSize = keyIndexSize;
+	header.keyStringsSize = static_cast<uint32_t>(keyStrings.size());
+	header.revision = PACKAGE_REVISION;
+	std::memcpy(header.signature, SIGNATURE, sizeof(header.signature));
+
+	// Writing table of contents to the back of the package
+	out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(PackageTOCEntry));
+	out.write(reinterpret_cast<const char*>(keyIndex.data()), keyIndex.size() * sizeof(uint32_t));
+	out.write(keyStrings.data(), keyStrings.size());
+
+	out.seekp(0);
+	out.write(reinterpret_cast<char*>(&header), sizeof(header));
+	out.close();
+
+	if (!out) {
+		std::cerr << "PackageManager::Pack(): Writing " << packageName << " failed" << std::endl;
+		fs::remove(targetPath);
+		return false;
+	}
+
+#ifdef DEBUG
+		std::cout << "Finished packing: " << packageName << std::endl;
+#endif
+
+	return true;
+}
+
+bool PackageManager::OpenPackage(const std::string& source, PackageMountMode mode, MountedPackage& mountedPackage, const char* caller)
+{
+	mountedPackage.path = source;
+
+	// Handle used by all asset loads until the package is unmounted
+	PackageFile& file = mountedPackage.file;
+	if (!file.Open(source)) {
+		std::cerr << caller << ": Could not open package file for reading" << std::endl;
+		return false;
+	}
+
+	PackageHeader header = {};
+	if (!file.ReadAt(0, &header, sizeof(header))) {
+		std::cerr << caller << ": Could not read header" << std::endl;
+		return false;
+	}
+
+	// Signature check
+	if (!CheckHeader(header, caller)) {
+		return false;
 	}
 
-	// Finalizing header
-	header.tableOfContentsOffset = out.tellp(); // Recording starting offset for the TOC
-	header.AssetCount = toc.size();
-	std::memcpy(header.signature, SIGNATURE, sizeof(header.signature));
-
-	// Writing table of contents to the back of the package
-	for (TOCEntry& entry : toc) {
-		// GUID
-		out.write(entry.guid.data(), GUID_STR_LENGTH);
+	// Size checks, nothing of the table of contents may point outside of the file
+	uint64_t entriesSize = static_cast<uint64_t>(header.AssetCount) * sizeof(PackageTOCEntry);
+	uint64_t keyIndexBytes = static_cast<uint64_t>(header.keyIndexSize) * sizeof(uint32_t);
+	if (header.tableOfContentsOffset % 8 != 0 || header.tableOfContentsOffset > file.GetSize() ||
+		header.tableOfContentsSize > file.GetSize() - header.tableOfContentsOffset ||
+		header.tableOfContentsSize != entriesSize + keyIndexBytes + header.keyStringsSize ||
+		(header.keyIndexSize & (header.keyIndexSize - 1)) != 0 || header.keyIndexSize < header.AssetCount ||
+		header.dictionaryOffset > file.GetSize() || header.dictionarySize > file.GetSize() - header.dictionaryOffset ||
+		header.dictionarySize > 64 * 1024) { // LZ4 only references the last 64 KiB, Pack never writes larger dictionaries
+		std::cerr << caller << ": Package is damaged" << std::endl;
+		return false;
+	}
 
-		// The length of the key
-		uint32_t keyLength = static_cast<uint32_t>(entry.key.size());
-		out.write(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
+	if (mode == PackageMountMode::Mapped) {
+		if (file.Map()) {
+			// Assets are loaded by GUID in any order
+			file.Advise(0, file.GetSize(), PackageAccess::Random);
+		}
+		else {
+			std::cerr << caller << ": Could not map package, falling back to streaming" << std::endl;
+		}
+	}
 
-		// The key
-		out.write(entry.key.data(), keyLength);
+	mountedPackage.dictionary.resize(header.dictionarySize);
+	if (!file.ReadAt(header.dictionaryOffset, mountedPackage.dictionary.data(), header.dictionarySize)) {
+		std::cerr << caller << ": Could not read dictionary" << std::endl;
+		return false;
+	}
 
-		// The entry data (PackageEntry)
-		out.write(reinterpret_cast<char*>(&entry.packageEntry), sizeof(entry.packageEntry));
+	// Table of contents, used in place when mapped, otherwise read with a single read
+	const char* tableOfContents = nullptr;
+	if (file.IsMapped()) {
+		tableOfContents = file.GetMappedData() + header.tableOfContentsOffset;
+	}
+	else {
+		mountedPackage.tableOfContentsData = std::make_unique<char[]>(header.tableOfContentsSize);
+		if (!file.ReadAt(header.tableOfContentsOffset, mountedPackage.tableOfContentsData.get(), header.tableOfContentsSize)) {
+			std::cerr << caller << ": Could not read table of contents" << std::endl;
+			return false;
+		}
+		tableOfContents = mountedPackage.tableOfContentsData.get();
 	}
 
-	out.seekp(0);
-	out.write(reinterpret_cast<char*>(&header), sizeof(header));
+	mountedPackage.entries = reinterpret_cast<const PackageTOCEntry*>(tableOfContents);
+	mountedPackage.entryCount = header.AssetCount;
+	mountedPackage.keyIndex = reinterpret_cast<const uint32_t*>(tableOfContents + entriesSize);
+	mountedPackage.keyIndexSize = header.keyIndexSize;
+	mountedPackage.keyStrings = tableOfContents + entriesSize + keyIndexBytes;
+
+	for (uint32_t i = 0; i < mountedPackage.entryCount; i++) {
+		const PackageTOCEntry& entry = mountedPackage.entries[i];
+		if (entry.keyOffset > header.keyStringsSize || entry.keyLength > header.keyStringsSize - entry.keyOffset) {
+			std::cerr << caller << ": Package is damaged" << std::endl;
+			return false;
+		}
+	}
 
-#ifdef DEBUG
-		std::cout << "Finished packing: " << packageName << std::endl;
-#endif
+	// Key index slots hold 0 (empty) or an entry number + 1, lookups run until they reach an empty slot
+	uint32_t emptySlots = 0;
+	for (uint32_t slot = 0; slot < mountedPackage.keyIndexSize; slot++) {
+		if (mountedPackage.keyIndex[slot] > mountedPackage.entryCount) {
+			std::cerr << caller << ": Package is damaged" << std::endl;
+			return false;
+		}
+		emptySlots += mountedPackage.keyIndex[slot] == 0 ? 1 : 0;
+	}
+	if (mountedPackage.keyIndexSize > 0 && emptySlots == 0) {
+		std::cerr << caller << ": Package is damaged" << std::endl;
+		return false;
+	}
 
 	return true;
 }
@@ -193,47 +1233,11 @@ bool PackageManager::Unpack(const std::string& source, const std::string& target
 		return false;
 	}
 
-	// Read file
-	std::ifstream in(sourcePath, std::ios::binary);
-	if (!in) {
-		std::cerr << "PackageManager::Unpack(): Could not read file" << std::endl;
+	MountedPackage package;
+	if (!OpenPackage(source, PackageMountMode::Stream, package, "PackageManager::Unpack()")) {
 		return false;
 	}
 
-	PackageHeader header;
-	in.read(reinterpret_cast<char*>(&header), sizeof(header));
-	
-	// Signature check
-	if (std::memcmp(header.signature, SIGNATURE, sizeof(header.signature)) != 0) {
-		std::cerr << "PackageManager::Unpack(): Signature does not match" << std::endl;
-		return false;
-	}
-
-	// Loop through toc and collect all entries
-	in.seekg(header.tableOfContentsOffset);
-	std::vector<TOCEntry> toc;
-	for (int i = 0; i < header.AssetCount; i++) {
-		TOCEntry entry;
-
-		// The GUID
-		entry.guid.resize(GUID_STR_LENGTH);
-		in.read(entry.guid.data(), GUID_STR_LENGTH);
-
-		// The length of the key
-		uint32_t keyLength;
-		in.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
-
-		// The key
-		entry.key.resize(keyLength);
-		in.read(entry.key.data(), keyLength);
-
-		// The entry data (PackageEntry)
-		in.read(reinterpret_cast<char*>(&entry.packageEntry), sizeof(entry.packageEntry));
-		
-		toc.push_back(entry);
-	}
-	in.clear(); // In case EOF is hit
-
 	// Create the unpacked package directory
 	targetPath = targetPath / sourcePath.stem();
 	if (fs::exists(targetPath)) {
@@ -247,38 +1251,26 @@ bool PackageManager::Unpack(const std::string& source, const std::string& target
 #endif
 
 	// Go through all entries and restore the files
-	for (auto& entry : toc) {
-		fs::path relativePath(entry.key);
+	for (uint32_t i = 0; i < package.entryCount; i++) {
+		const PackageTOCEntry& entry = package.entries[i];
+		std::string key(package.GetKey(entry));
+
+		fs::path relativePath(key);
 		fs::path filePath = targetPath / relativePath;
 
 		// Creating necessary directories within the package
 		if (filePath.has_parent_path()) {
 			fs::create_directories(filePath.parent_path());
 		}
-		
-		// Reading the compressed data from the package
-		AssetData compressedData;
-		compressedData.size = entry.packageEntry.sizeCompressed;
-		compressedData.data = std::make_unique<char[]>(entry.packageEntry.sizeCompressed);
-
-		in.seekg(entry.packageEntry.offset);
-		in.read(compressedData.data.get(), compressedData.size);
 
-		// Decompressing the compressed data
+		// Reading and decompressing the data from the package
 		AssetData uncompressedData;
 		uncompressedData.size = entry.packageEntry.size;
 		uncompressedData.data = std::make_unique<char[]>(entry.packageEntry.size);
 
-		int uncompressedSize = LZ4_decompress_safe(
-			compressedData.data.get(), 
-			uncompressedData.data.get(), 
-			static_cast<int>(compressedData.size), 
-			static_cast<int>(uncompressedData.size)
-		);
-
-		if (uncompressedSize < 0) {
+		if (!ReadAsset(package, entry, uncompressedData.data.get())) {
 			// Decompression failed
-			std::cerr << "PackageManager::Unpack(): Decompression failed for " << entry.key << std::endl;
+			std::cerr << "PackageManager::Unpack(): Decompression failed for " << key << std::endl;
 			continue;
 		}
 
@@ -286,11 +1278,11 @@ bool PackageManager::Unpack(const std::string& source, const std::string& target
 		out.write(uncompressedData.data.get(), uncompressedData.size);
 
 #ifdef DEBUG
-			std::cout << "Unpacked " << entry.key << " (" << compressedData.size << " -> " << uncompressedData.size << " bytes)" << std::endl;
+			std::cout << "Unpacked " << key << " (" << entry.packageEntry.sizeCompressed << " -> " << uncompressedData.size << " bytes)" << std::endl;
 #endif
 
-		if (!GuidUtils::CreateMetaFileFromGuid(filePath, entry.guid)) {
-			std::cerr << "PackageManager::Unpack(): Could not create meta file for " << entry.key << std::endl;
+		if (!GuidUtils::CreateMetaFileFromGuid(filePath, GuidUtils::FormatGuid(entry.guid.bytes))) {
+			std::cerr << "PackageManager::Unpack(): Could not create meta file for " << key << std::endl;
 			continue;
 		}
 	}
@@ -298,8 +1290,10 @@ bool PackageManager::Unpack(const std::string& source, const std::string& target
 	return true;
 }
 
-bool PackageManager::MountPackage(const std::string& source)
+bool PackageManager::MountPackage(const std::string& source, PackageMountMode mode)
 {
+	HeapTagScope heapScope("Package TOC");
+
 	fs::path sourcePath(source);
 
 	// Path validity checks
@@ -313,52 +1307,9 @@ bool PackageManager::MountPackage(const std::string& source)
 		return false;
 	}
 
-	// Read file
-	std::ifstream in(sourcePath, std::ios::binary);
-	if (!in) {
-		std::cerr << "PackageManager::MountPackage(): Could not read file" << std::endl;
-		return false;
-	}
-
-	PackageHeader header;
-	in.read(reinterpret_cast<char*>(&header), sizeof(header));
-
-	// Signature check
-	if (std::memcmp(header.signature, SIGNATURE, sizeof(header.signature)) != 0) {
-		std::cerr << "PackageManager::MountPackage(): Signature does not match" << std::endl;
-		return false;
-	}
-
 	MountedPackage mountedPackage;
-	mountedPackage.path = source;
-
-	// Loop through toc and collect all entries
-	in.seekg(header.tableOfContentsOffset);
-	for (int i = 0; i < header.AssetCount; i++) {
-		TOCEntry entry;
-
-		// The GUID
-		std::string guid;
-		guid.resize(GUID_STR_LENGTH);
-		in.read(guid.data(), GUID_STR_LENGTH);
-
-		// The length of the key
-		uint32_t keyLength;
-		in.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
-
-		// The key
-		std::string key;
-		key.resize(keyLength);
-		in.read(key.data(), keyLength);
-
-		// The entry data (PackageEntry)
-		in.read(reinterpret_cast<char*>(&entry.packageEntry), sizeof(entry.packageEntry));
-
-		entry.guid = guid;
-		entry.key = key;
-
-		mountedPackage.tocByKey.emplace(key, entry);
-		mountedPackage.tocByGuid.emplace(guid, entry);
+	if (!OpenPackage(source, mode, mountedPackage, "PackageManager::MountPackage()")) {
+		return false;
 	}
 
 	std::string packageKey = sourcePath.stem().generic_string();
@@ -367,8 +1318,13 @@ bool PackageManager::MountPackage(const std::string& source)
 		// Locking read/write during vector and unoredered map manipulation (thread safety)
 		std::unique_lock<std::shared_mutex> lock(_mountMutex);
 
-		_mountedPackages.emplace(packageKey, std::move(mountedPackage)); // Have to use std::move as mountedPackage is non-copyable
+		auto [packagePair, inserted] = _mountedPackages.emplace(packageKey, std::move(mountedPackage)); // Have to use std::move as mountedPackage is non-copyable
+		if (!inserted) {
+			std::cerr << "PackageManager::MountPackage(): A package with the same name is already mounted" << std::endl;
+			return false;
+		}
 		_mountOrder.push_back(packageKey);
+		AddToIndex(packagePair->second);
 	}
 
 #ifdef DEBUG
@@ -381,7 +1337,7 @@ bool PackageManager::MountPackage(const std::string& source)
 bool PackageManager::UnmountPackage()
 {
 	// Locks read/write during vector and unoredered map manipulation (thread safety)
-	std::unique_lock<std::shared_mutex> lock(_mountMutex);
+	std::unique_lock<std::shared_mutex> lock = LockForUnmount();
 
 	// Removing the mounted package
 	if (_mountOrder.empty()) {
@@ -396,11 +1352,12 @@ bool PackageManager::UnmountPackage()
 		std::cerr << "PackageManager::UnmountPackage(): No package with matching key has been mounted" << std::endl;
 		return false;
 	}
-	_mountedPackages.erase(packagePair);
-
 	// Removing the mounted package key from mounting order
 	_mountOrder.pop_back();
 
+	RemoveFromIndex(packagePair->second);
+	_mountedPackages.erase(packagePair);
+
 #ifdef DEBUG
 		std::cout << "Unmounted package: " << packageKey << std::endl;
 #endif
@@ -411,7 +1368,7 @@ bool PackageManager::UnmountPackage()
 bool PackageManager::UnmountPackage(const std::string& packageKey)
 {
 	// Locks read/write during vector and unoredered map manipulation (thread safety)
-	std::unique_lock<std::shared_mutex> lock(_mountMutex);
+	std::unique_lock<std::shared_mutex> lock = LockForUnmount();
 
 	// Removing the mounted package
 	auto packagePair = _mountedPackages.find(packageKey);
@@ -419,12 +1376,13 @@ bool PackageManager::UnmountPackage(const std::string& packageKey)
 		std::cerr << "PackageManager::UnmountPackage(): No package with matching key has been mounted" << std::endl;
 		return false;
 	}
-	_mountedPackages.erase(packagePair);
-
 	// Removing the mounted package key from mounting order
 	auto newEnd = std::remove(_mountOrder.begin(), _mountOrder.end(), packageKey);
 	_mountOrder.erase(newEnd, _mountOrder.end());
 
+	RemoveFromIndex(packagePair->second);
+	_mountedPackages.erase(packagePair);
+
 #ifdef DEBUG
 		std::cout << "Unmounted package: " << packageKey << std::endl;
 #endif
@@ -434,13 +1392,15 @@ bool PackageManager::UnmountPackage(const std::string& packageKey)
 
 bool PackageManager::UnmountAllPackages()
 {
-	std::unique_lock<std::shared_mutex> lock(_mountMutex);
+	std::unique_lock<std::shared_mutex> lock = LockForUnmount();
 
 	if (_mountOrder.empty()) {
 		std::cerr << "PackageManger::UnmountAllPackages(): No packages are currently mounted" << std::endl;
 		return false;
 	}
 
+	_guidIndex.clear();
+	_keyIndex.clear();
 	_mountedPackages.clear();
 	_mountOrder.clear();
 
@@ -456,27 +1416,24 @@ bool PackageManager::LoadAssetByGuid(const std::string& guid, AssetData& asset)
 	// Locks write operations to mount containers (thread safety)
 	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
 
-	for (size_t i = _mountOrder.size(); i != 0; --i) {
-		std::string packageKey = _mountOrder.at(i - 1);
+	const MountedPackage* mountedPackage = nullptr;
+	const PackageTOCEntry* tocEntry = nullptr;
+	if (!FindAssetByGuid(guid, mountedPackage, tocEntry)) {
+		std::cerr << "PackageManager::LoadAssetByGuid(): Asset does not exist within a mounted package" << std::endl;
+		return false;
+	}
+	RecordAccess(*mountedPackage, *tocEntry);
 
-		MountedPackage& mountedPackage = _mountedPackages.find(packageKey)->second;
-		auto pair = mountedPackage.tocByGuid.find(guid);
-		if (pair != mountedPackage.tocByGuid.end()) {
-			// Asset found -> load it
-			if (!LoadAsset(mountedPackage, pair->second, asset)) {
-				std::cerr << "PackageManager::LoadAssetByGuid(): Unable to load asset" << std::endl;
-				return false;
-			}
+	// Asset found -> load it
+	if (!LoadAsset(*mountedPackage, *tocEntry, asset)) {
+		std::cerr << "PackageManager::LoadAssetByGuid(): Unable to load asset" << std::endl;
+		return false;
+	}
 
 #ifdef DEBUG
-				std::cout << "Loaded asset with GUID: |" << guid << "| From package: " << packageKey << std::endl;
+		std::cout << "Loaded asset with GUID: |" << guid << "| From package: " << mountedPackage->path << std::endl;
 #endif
-			return true;
-		}
-	}
-
-	std::cerr << "PackageManager::LoadAssetByGuid(): Asset does not exist within a mounted package" << std::endl;
-	return false;
+	return true;
 }
 
 bool PackageManager::LoadAssetByKey(const std::string& key, AssetData& asset)
@@ -484,29 +1441,468 @@ bool PackageManager::LoadAssetByKey(const std::string& key, AssetData& asset)
 	// Locks write operations to mount containers (thread safety)
 	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
 
-	for (size_t i = _mountOrder.size(); i != 0; --i) {
-		std::string packageKey = _mountOrder.at(i - 1);
+	auto location = _keyIndex.find(key);
+	if (location != _keyIndex.end()) {
+		RecordAccess(*location->second.package, *location->second.entry);
 
-		MountedPackage& mountedPackage = _mountedPackages.find(packageKey)->second;
-		auto pair = mountedPackage.tocByKey.find(key);
-		if (pair != mountedPackage.tocByKey.end()) {
-			// Asset found -> load it
-			if (!LoadAsset(mountedPackage, pair->second, asset)) {
-				std::cerr << "PackageManager::LoadAssetByKey(): Unable to load asset" << std::endl;
-				return false;
-			}
+		// Asset found -> load it
+		if (!LoadAsset(*location->second.package, *location->second.entry, asset)) {
+			std::cerr << "PackageManager::LoadAssetByKey(): Unable to load asset" << std::endl;
+			return false;
+		}
 
 #ifdef DEBUG
-				std::cout << "Loaded asset with key: |" << key << "| From package: " << packageKey << std::endl;
+			std::cout << "Loaded asset with key: |" << key << "| From package: " << location->second.package->path << std::endl;
 #endif
-			return true;
-		}
+		return true;
 	}
 
 	std::cerr << "PackageManager::LoadAssetByKey(): Asset does not exist within a mounted package" << std::endl;
 	return false;
 }
 
+void PackageManager::RecordAccess(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry)
+{
+	if (!_recordingAccesses.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_accessMutex);
+	std::string key(mountedPackage.GetKey(tocEntry));
+	if (_accessedKeys.insert(key).second) {
+		_accessOrder.push_back(std::move(key));
+	}
+}
+
+void PackageManager::StartAccessRecording()
+{
+	std::lock_guard<std::mutex> lock(_accessMutex);
+	_accessOrder.clear();
+	_accessedKeys.clear();
+	_recordingAccesses = true;
+}
+
+bool PackageManager::StopAccessRecording(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_accessMutex);
+	if (!_recordingAccesses) {
+		std::cerr << "PackageManager::StopAccessRecording(): Accesses are not being recorded" << std::endl;
+		return false;
+	}
+	_recordingAccesses = false;
+
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "PackageManager::StopAccessRecording(): Unable to create " << path << std::endl;
+		return false;
+	}
+
+	out << "# Asset keys in first-use order, layout manifest for PackageManager::Pack" << std::endl;
+	for (const std::string& key : _accessOrder) {
+		out << key << '\n';
+	}
+
+	_accessOrder.clear();
+	_accessedKeys.clear();
+	return out.good();
+}
+
+bool PackageManager::PrefetchPackage(const std::string& packageKey)
+{
+	std::shared_lock<std::shared_mutex> lock(_mountMutex);
+
+	auto packageIt = _mountedPackages.find(packageKey);
+	if (packageIt == _mountedPackages.end()) {
+		std::cerr << "PackageManager::PrefetchPackage(): Package not mounted: " << packageKey << std::endl;
+		return false;
+	}
+
+	const PackageFile& file = packageIt->second.file;
+	file.Advise(0, file.GetSize(), PackageAccess::WillNeed);
+	return true;
+}
+
+bool PackageManager::LoadAssets(const std::vector<std::string>& guids, const std::function<void(const std::string& guid, AssetData& asset)>& loaded)
+{
+	HeapTagScope heapScope("Package load");
+
+	// Locks write operations to mount containers (thread safety)
+	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
+
+	struct BatchEntry {
+		const std::string* guid;
+		const MountedPackage* package;
+		const PackageTOCEntry* tocEntry;
+	};
+
+	bool succeeded = true;
+	std::vector<BatchEntry> batch;
+	batch.reserve(guids.size());
+	for (const std::string& guid : guids) {
+		BatchEntry entry = { &guid, nullptr, nullptr };
+		if (!FindAssetByGuid(guid, entry.package, entry.tocEntry)) {
+			std::cerr << "PackageManager::LoadAssets(): Asset " << guid << " does not exist within a mounted package" << std::endl;
+			succeeded = false;
+			continue;
+		}
+
+		const PackageEntry& packageEntry = entry.tocEntry->packageEntry;
+		uint64_t fileSize = entry.package->file.GetSize();
+		if (packageEntry.offset > fileSize || packageEntry.sizeCompressed > fileSize - packageEntry.offset) {
+			std::cerr << "PackageManager::LoadAssets(): Entry " << entry.package->GetKey(*entry.tocEntry) << " lies outside of the package file" << std::endl;
+			succeeded = false;
+			continue;
+		}
+
+		RecordAccess(*entry.package, *entry.tocEntry);
+		batch.push_back(entry);
+	}
+
+	// Grouped by package, in file order inside a package
+	std::sort(batch.begin(), batch.end(), [](const BatchEntry& a, const BatchEntry& b) {
+		if (a.package != b.package) {
+			return std::less<const MountedPackage*>()(a.package, b.package);
+		}
+		return a.tocEntry->packageEntry.offset < b.tocEntry->packageEntry.offset;
+	});
+
+	// Neighbouring entries of a package are coalesced into runs read with a single read
+	struct ReadRun {
+		const MountedPackage* package;
+		size_t first;
+		size_t last;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	std::vector<ReadRun> runs;
+	for (size_t i = 0; i < batch.size(); i++) {
+		const PackageEntry& packageEntry = batch[i].tocEntry->packageEntry;
+		uint64_t entryEnd = packageEntry.offset + packageEntry.sizeCompressed;
+
+		if (!runs.empty()) {
+			ReadRun& run = runs.back();
+			uint64_t runEnd = run.offset + run.size;
+			uint64_t end = std::max(runEnd, entryEnd);
+			if (run.package == batch[i].package && packageEntry.offset <= runEnd + PACKAGE_BATCH_READ_GAP && end - run.offset <= PACKAGE_BATCH_READ_SIZE) {
+				run.last = i;
+				run.size = end - run.offset;
+				continue;
+			}
+		}
+
+		runs.push_back({ batch[i].package, i, i, packageEntry.offset, packageEntry.sizeCompressed });
+	}
+
+	// Double buffered, a run is read on another thread while the previous one is decompressed
+	// Mapped packages are not read, the OS is asked to page the next run in instead
+	std::vector<char> buffers[2];
+	std::future<bool> reads[2];
+	auto startRead = [&](size_t index) {
+		const ReadRun& run = runs[index];
+		const PackageFile& file = run.package->file;
+		if (file.IsMapped()) {
+			file.Advise(run.offset, run.size, PackageAccess::WillNeed);
+			return;
+		}
+
+		std::vector<char>& buffer = buffers[index % 2];
+		buffer.resize(run.size);
+		reads[index % 2] = std::async(std::launch::async, [&file, &buffer, run]() {
+			return file.ReadAt(run.offset, buffer.data(), run.size);
+		});
+	};
+
+	if (!runs.empty()) {
+		startRead(0);
+	}
+
+	for (size_t r = 0; r < runs.size(); r++) {
+		const ReadRun& run = runs[r];
+		bool mapped = run.package->file.IsMapped();
+
+		bool read = mapped || reads[r % 2].get();
+		if (!read) {
+			std::cerr << "PackageManager::LoadAssets(): Could not read from " << run.package->path << std::endl;
+		}
+
+		if (r + 1 < runs.size()) {
+			startRead(r + 1);
+		}
+
+		for (size_t i = run.first; i <= run.last; i++) {
+			const BatchEntry& entry = batch[i];
+
+			AssetData asset;
+			bool assetLoaded = false;
+			if (mapped) {
+				assetLoaded = LoadAsset(*entry.package, *entry.tocEntry, asset);
+			}
+			else if (read) {
+				const char* source = buffers[r % 2].data() + (entry.tocEntry->packageEntry.offset - run.offset);
+				assetLoaded = DecodeAsset(*entry.package, *entry.tocEntry, source, asset);
+			}
+
+			if (!assetLoaded) {
+				std::cerr << "PackageManager::LoadAssets(): Unable to load asset " << *entry.guid << std::endl;
+				succeeded = false;
+				continue;
+			}
+
+			loaded(*entry.guid, asset);
+		}
+	}
+
+	return succeeded;
+}
+
+AsyncPackageReader& PackageManager::GetAsyncReader()
+{
+	std::call_once(_asyncReaderCreated, [this]() {
+		_asyncReader = std::make_unique<AsyncPackageReader>();
+	});
+	return *_asyncReader;
+}
+
+std::unique_lock<std::shared_mutex> PackageManager::LockForUnmount()
+{
+	// Waits without holding _mountMutex, completions may load other assets
+	std::unique_lock<std::shared_mutex> lock(_mountMutex);
+	while (true) {
+		{
+			std::lock_guard<std::mutex> asyncLock(_asyncMutex);
+			if (_asyncLoads == 0) {
+				return lock;
+			}
+		}
+
+		lock.unlock();
+		WaitForAsyncLoads();
+		lock.lock();
+	}
+}
+
+void PackageManager::FinishAsyncLoad()
+{
+	std::lock_guard<std::mutex> lock(_asyncMutex);
+	if (--_asyncLoads == 0) {
+		_asyncLoadsDone.notify_all();
+	}
+}
+
+void PackageManager::WaitForAsyncLoads()
+{
+	std::unique_lock<std::mutex> lock(_asyncMutex);
+	_asyncLoadsDone.wait(lock, [this]() { return _asyncLoads == 0; });
+}
+
+bool PackageManager::LoadAssetByGuidAsync(const std::string& guid, std::function<void(bool loaded, AssetData& asset)> completed)
+{
+	HeapTagScope heapScope("Package load");
+
+	// Locks write operations to mount containers (thread safety)
+	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
+
+	const MountedPackage* mountedPackage = nullptr;
+	const PackageTOCEntry* tocEntry = nullptr;
+	if (!FindAssetByGuid(guid, mountedPackage, tocEntry)) {
+		std::cerr << "PackageManager::LoadAssetByGuidAsync(): Asset does not exist within a mounted package" << std::endl;
+		return false;
+	}
+	RecordAccess(*mountedPackage, *tocEntry);
+
+	const PackageEntry& packageEntry = tocEntry->packageEntry;
+	const PackageFile& file = mountedPackage->file;
+	if (packageEntry.offset > file.GetSize() || packageEntry.sizeCompressed > file.GetSize() - packageEntry.offset) {
+		std::cerr << "PackageManager::LoadAssetByGuidAsync(): Entry " << mountedPackage->GetKey(*tocEntry) << " lies outside of the package file" << std::endl;
+		return false;
+	}
+
+	AsyncPackageReader& reader = GetAsyncReader();
+	{
+		// Counted while the mount lock is held, so the package stays mounted until the load has finished
+		std::lock_guard<std::mutex> lock(_asyncMutex);
+		_asyncLoads++;
+	}
+
+	// Shared by the read and its completion (std::function needs copyable captures)
+	struct AsyncLoad {
+		AssetData asset;
+		std::unique_ptr<char[]> compressed;
+		std::function<void(bool loaded, AssetData& asset)> completed;
+	};
+	auto load = std::make_shared<AsyncLoad>();
+	load->completed = std::move(completed);
+
+	auto finish = [this, load](bool loaded) {
+		if (!loaded) {
+			std::cerr << "PackageManager::LoadAssetByGuidAsync(): Unable to load asset" << std::endl;
+			load->asset = AssetData();
+		}
+		load->completed(loaded, load->asset);
+		FinishAsyncLoad();
+	};
+
+	// Mapped packages need no read, the asset is decompressed (or viewed) on a worker
+	if (file.IsMapped()) {
+		reader.Run([this, load, finish, mountedPackage, tocEntry]() {
+			finish(LoadAsset(*mountedPackage, *tocEntry, load->asset));
+		});
+		return true;
+	}
+
+	// Stored entries are read straight into the asset
+	if (packageEntry.codec == PackageCodec::Store) {
+		load->asset.size = packageEntry.size;
+		load->asset.data = std::make_unique<char[]>(packageEntry.size);
+		load->asset.fileExtension = fs::path(mountedPackage->GetKey(*tocEntry)).extension().string();
+		reader.Read(file, packageEntry.offset, load->asset.data.get(), packageEntry.size, finish);
+		return true;
+	}
+
+	load->compressed = std::make_unique<char[]>(packageEntry.sizeCompressed);
+	reader.Read(file, packageEntry.offset, load->compressed.get(), packageEntry.sizeCompressed, [this, load, finish, mountedPackage, tocEntry](bool read) {
+		bool decoded = read && DecodeAsset(*mountedPackage, *tocEntry, load->compressed.get(), load->asset);
+		load->compressed.reset();
+		finish(decoded);
+	});
+	return true;
+}
+
+bool PackageManager::GetAssetSizeByGuid(const std::string& guid, uint64_t& size)
+{
+	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
+
+	const MountedPackage* mountedPackage = nullptr;
+	const PackageTOCEntry* tocEntry = nullptr;
+	if (!FindAssetByGuid(guid, mountedPackage, tocEntry)) {
+		std::cerr << "PackageManager::GetAssetSizeByGuid(): Asset does not exist within a mounted package" << std::endl;
+		return false;
+	}
+
+	size = tocEntry->packageEntry.size;
+	return true;
+}
+
+bool PackageManager::LoadAssetByGuid(const std::string& guid, const std::function<void*(uint64_t size)>& allocate, uint64_t& size)
+{
+	HeapTagScope heapScope("Package load");
+
+	// Locks write operations to mount containers (thread safety)
+	// Held during the whole load so the entry can not change between sizing and reading
+	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
+
+	const MountedPackage* mountedPackage = nullptr;
+	const PackageTOCEntry* tocEntry = nullptr;
+	if (!FindAssetByGuid(guid, mountedPackage, tocEntry)) {
+		std::cerr << "PackageManager::LoadAssetByGuid(): Asset does not exist within a mounted package" << std::endl;
+		return false;
+	}
+	RecordAccess(*mountedPackage, *tocEntry);
+
+	size = tocEntry->packageEntry.size;
+	char* destination = static_cast<char*>(allocate(size));
+	if (!destination) {
+		std::cerr << "PackageManager::LoadAssetByGuid(): Could not get " << size << " bytes of destination memory" << std::endl;
+		return false;
+	}
+
+	if (!ReadAsset(*mountedPackage, *tocEntry, destination)) {
+		std::cerr << "PackageManager::LoadAssetByGuid(): Unable to load asset" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool PackageManager::LoadAssetByGuid(const std::string& guid, void* buffer, uint64_t bufferSize, uint64_t& size)
+{
+	return LoadAssetByGuid(guid, [&](uint64_t assetSize) -> void* {
+		return assetSize <= bufferSize ? buffer : nullptr;
+	}, size);
+}
+
+bool PackageManager::LoadAssetRangeByGuid(const std::string& guid, uint64_t offset, uint64_t size, void* buffer)
+{
+	HeapTagScope heapScope("Package load");
+
+	std::shared_lock<std::shared_mutex> mountLock(_mountMutex);
+
+	const MountedPackage* mountedPackage = nullptr;
+	const PackageTOCEntry* tocEntry = nullptr;
+	if (!FindAssetByGuid(guid, mountedPackage, tocEntry)) {
+		std::cerr << "PackageManager::LoadAssetRangeByGuid(): Asset does not exist within a mounted package" << std::endl;
+		return false;
+	}
+	RecordAccess(*mountedPackage, *tocEntry);
+
+	return ReadAssetRange(*mountedPackage, *tocEntry, offset, size, static_cast<char*>(buffer));
+}
+
+std::vector<DuplicateContent> PackageManager::FindDuplicateContent()
+{
+	std::shared_lock<std::shared_mutex> lock(_mountMutex);
+
+	// Stored copies of every content, entries sharing data inside a package are one copy
+	struct StoredCopy {
+		const MountedPackage* package;
+		uint64_t offset;
+		uint64_t sizeCompressed;
+	};
+	struct Content {
+		uint64_t size = 0;
+		std::vector<std::string> locations;
+		std::vector<StoredCopy> copies;
+	};
+
+	std::unordered_map<uint64_t, Content> contents;
+	for (const std::string& packageKey : _mountOrder) {
+		const MountedPackage& package = _mountedPackages.find(packageKey)->second;
+		for (uint32_t i = 0; i < package.entryCount; i++) {
+			const PackageEntry& packageEntry = package.entries[i].packageEntry;
+
+			Content& content = contents[packageEntry.contentHash];
+			content.size = packageEntry.size;
+			content.locations.push_back(packageKey + "/" + std::string(package.GetKey(package.entries[i])));
+
+			bool stored = std::any_of(content.copies.begin(), content.copies.end(), [&](const StoredCopy& copy) {
+				return copy.package == &package && copy.offset == packageEntry.offset;
+			});
+			if (!stored) {
+				content.copies.push_back({ &package, packageEntry.offset, packageEntry.sizeCompressed });
+			}
+		}
+	}
+
+	std::vector<DuplicateContent> duplicates;
+	for (auto& [hash, content] : contents) {
+		if (content.copies.size() < 2) {
+			continue;
+		}
+
+		DuplicateContent duplicate;
+		duplicate.contentHash = hash;
+		duplicate.size = content.size;
+		duplicate.locations = std::move(content.locations);
+		duplicate.wastedBytes = 0;
+		for (size_t i = 1; i < content.copies.size(); i++) {
+			duplicate.wastedBytes += content.copies[i].sizeCompressed;
+		}
+		duplicates.push_back(std::move(duplicate));
+	}
+
+	std::sort(duplicates.begin(), duplicates.end(), [](const DuplicateContent& a, const DuplicateContent& b) {
+		return a.wastedBytes > b.wastedBytes;
+	});
+	return duplicates;
+}
+
+bool PackageManager::IsPackageMounted(const std::string& packageKey)
+{
+	std::shared_lock<std::shared_mutex> lock(_mountMutex);
+	return _mountedPackages.find(packageKey) != _mountedPackages.end();
+}
+
 std::vector<std::string> PackageManager::GetGUIDsInPackage(const std::string& packageKey)
 {
 	std::vector<std::string> guids;
@@ -523,9 +1919,9 @@ std::vector<std::string> PackageManager::GetGUIDsInPackage(const std::string& pa
 
 	const MountedPackage& package = packageIt->second;
 
-	guids.reserve(package.tocByGuid.size());
-	for (const auto& [guid, entry] : package.tocByGuid) {
-		guids.push_back(guid);
+	guids.reserve(package.entryCount);
+	for (uint32_t i = 0; i < package.entryCount; i++) {
+		guids.push_back(GuidUtils::FormatGuid(package.entries[i].guid.bytes));
 	}
 
 	return guids;
@@ -4,44 +4,145 @@
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
 #include <vector>
 #include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string_view>
+#include <cstring>
 
-inline constexpr char SIGNATURE[8] = "GEPAKV0"; // Signature for files packaged by this package manager
+#include "PackageFile.h"
+#include "AsyncPackageReader.h"
+#include "Settings.h"
+#include "AllocationTag.h"
+
+inline constexpr char SIGNATURE[8] = "GEPAKV1"; // Signature for files packaged by this package manager
+inline constexpr uint32_t PACKAGE_REVISION = 4; // Increased on every change to the layout, older packages are rebuilt by Pack
+
+// Package layout (GEPAK v1):
+// header | dictionary | entry data | table of contents
+// The table of contents is read in one go (or used in place when mapped) and needs no parsing:
+// PackageTOCEntry[AssetCount] sorted by GUID | uint32_t key index[keyIndexSize] | key strings[keyStringsSize]
 
 // Written at the very start of a package file
 struct PackageHeader {
-	char signature[5];
+	char signature[8];
 	uint32_t AssetCount;
-	uint64_t tableOfContentsOffset;
+	uint32_t revision;
+	uint64_t tableOfContentsOffset; // 8 byte aligned
+	uint64_t tableOfContentsSize;
+	uint64_t dictionaryOffset; // Shared LZ4 dictionary of the package (written right after the header)
+	uint64_t dictionarySize; // 0 if the package has no dictionary
+	uint32_t keyIndexSize; // Slots of the key hash index (power of two)
+	uint32_t keyStringsSize;
+	uint64_t sourceManifestHash; // Hash of the paths, sizes and write times of the source files (see IsPackageUpToDate)
+};
+
+// How the data of an entry is stored
+enum class PackageCodec : uint32_t {
+	Store = 0,	// Raw bytes, loaded without decompression (views into mapped packages)
+	LZ4 = 1,
+	LZ4Dictionary = 3	// LZ4 with the shared dictionary of the package (small single block entries)
 };
 
 // Specifies the details of a file inside a package
 struct PackageEntry {
 	uint64_t offset;
 	uint64_t size;
-	uint64_t sizeCompressed;
+	uint64_t sizeCompressed; // Stored bytes including the chunk table, equal to size for stored entries
+	PackageCodec codec;
+	uint32_t reserved; // Always 0
+	uint32_t chunkSize; // Uncompressed size of the chunks, 0 if the entry is a single block (see PackageCompression.h)
+	uint32_t chunkCount;
+	uint64_t contentHash; // Hash of the uncompressed data, entries with equal content share their stored data
+};
+
+// GUID in the binary form used by the table of contents
+struct PackageGuid {
+	uint8_t bytes[16];
+
+	bool operator<(const PackageGuid& other) const {
+		return std::memcmp(bytes, other.bytes, sizeof(bytes)) < 0;
+	}
+	bool operator==(const PackageGuid& other) const {
+		return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+	}
+};
+
+// GUIDs are random, the first bytes are used as they are
+struct PackageGuidHash {
+	size_t operator()(const PackageGuid& guid) const {
+		size_t hash;
+		std::memcpy(&hash, guid.bytes, sizeof(hash));
+		return hash;
+	}
 };
 
-// Represents a file in a package
-struct TOCEntry {
-	std::string guid;
-	std::string key;
+// Represents a file in a package (fixed size record of the table of contents)
+struct PackageTOCEntry {
+	PackageGuid guid; // GUID of the asset found in its .meta file (file.extension.meta)
+	uint32_t keyOffset; // Key: name of the file inside the package (file.extension), in the key strings
+	uint32_t keyLength;
 	PackageEntry packageEntry;
 };
+static_assert(sizeof(PackageTOCEntry) == 72, "PackageTOCEntry is stored in package files");
 
-// Supports lookup by GUID and by path
+// How a package is read while mounted
+enum class PackageMountMode {
+	Stream,	// Entries are read into a buffer with positional reads
+	Mapped	// The package is memory-mapped, entries are decompressed from (or returned as views into) the mapping
+};
+
+// Supports lookup by GUID (binary search) and by path (hash index)
 struct MountedPackage {
 	std::string path; // Path to the mounted package
-	std::unordered_map<std::string, TOCEntry> tocByKey; // Key (string): name of the file inside the package (file.extension)
-	std::unordered_map<std::string, TOCEntry> tocByGuid; // Key (string): GUID of the asset found in its .meta file (file.extension.meta)
+	PackageFile file; // Kept open while mounted, shared by all loading threads
+	std::vector<char> dictionary; // Shared LZ4 dictionary of the package (empty if it has none)
+
+	// Table of contents, points into tableOfContentsData or into the mapping of the file
+	std::unique_ptr<char[]> tableOfContentsData;
+	const PackageTOCEntry* entries = nullptr; // Sorted by GUID
+	uint32_t entryCount = 0;
+	const uint32_t* keyIndex = nullptr; // Entry index + 1 per slot, 0 = empty slot
+	uint32_t keyIndexSize = 0;
+	const char* keyStrings = nullptr;
+
+	const PackageTOCEntry* FindByGuid(const PackageGuid& guid) const;
+	const PackageTOCEntry* FindByKey(std::string_view key) const;
+	std::string_view GetKey(const PackageTOCEntry& entry) const {
+		return std::string_view(keyStrings + entry.keyOffset, entry.keyLength);
+	}
+};
+
+// Content stored more than once across the mounted packages
+struct DuplicateContent {
+	uint64_t contentHash;
+	uint64_t size; // Uncompressed size
+	std::vector<std::string> locations; // package/key of every entry with the content
+	uint64_t wastedBytes; // Stored bytes of all copies but one (entries sharing data inside a package count once)
+};
+
+// Where the asset with the highest priority for a GUID or key is stored
+struct AssetLocation {
+	const MountedPackage* package;
+	const PackageTOCEntry* entry;
 };
 
 // Used to load and store asset file data
 struct AssetData {
-	std::unique_ptr<char[]> data;
+	std::unique_ptr<char[]> data; // Owned data, empty if the asset is a view
 	uint64_t size;
 	std::string fileExtension;
+
+	const char* view = nullptr; // Set instead of data when the asset points into a mapped package
+	std::shared_ptr<const void> viewOwner; // Keeps the memory of a view alive (also after unmounting)
+
+	const char* GetData() const {
+		return view ? view : data.get();
+	}
 };
 
 class PackageManager {
@@ -49,22 +150,80 @@ private:
 	std::unordered_map<std::string, MountedPackage> _mountedPackages; // key (string): name of the package file (package.gepak)
 	std::vector<std::string> _mountOrder; // The order of which an asset loading functions checks packages for assets (back = highest priority)
 
+	// Merged indexes of all mounted packages, only hold the asset with the highest priority
+	// Keys point into the tables of contents of the mounted packages
+	std::unordered_map<PackageGuid, AssetLocation, PackageGuidHash> _guidIndex;
+	std::unordered_map<std::string_view, AssetLocation> _keyIndex;
+
 	std::shared_mutex _mountMutex; // Used to ensure that only one thread can mount and unmount at once
 
+	// Async loads read from mounted packages after _mountMutex is released, packages are only unmounted once none are in flight
+	std::mutex _asyncMutex;
+	std::condition_variable _asyncLoadsDone;
+	uint32_t _asyncLoads = 0;
+	std::once_flag _asyncReaderCreated;
+
+	// Keys of the assets in the order they were first loaded while recording (layout manifest for Pack)
+	std::atomic<bool> _recordingAccesses = false;
+	std::mutex _accessMutex;
+	std::vector<std::string> _accessOrder;
+	std::unordered_set<std::string> _accessedKeys;
+
+	std::unique_ptr<AsyncPackageReader> _asyncReader; // Created by the first async load, declared last so it completes its loads before the packages are destroyed
+
+	// Writes the files of source to a package at packagePath (see Pack and PackPatch)
+	// Entries of previous with unchanged content are copied, files with unchanged content in base are left out
+	// sourceCache holds the sizes, write times and content hashes of the files the last time they were packed,
+	// the states of this pack are written to targetCache (both are the same file for Pack)
+	bool WritePackage(const std::string& source, const std::string& packagePath, const std::string& layoutManifest,
+		const MountedPackage* previous, const MountedPackage* base, const std::string& sourceCache, const std::string& targetCache);
+	// Opens a package file and reads its dictionary and table of contents (used by mounting and unpacking)
+	bool OpenPackage(const std::string& source, PackageMountMode mode, MountedPackage& mountedPackage, const char* caller);
+
 	// Loads asset from a specified mounted package
-	bool LoadAsset(MountedPackage& mountedPackage, const TOCEntry& tocEntry, AssetData& asset);
+	bool LoadAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, AssetData& asset);
+	// Decompresses an entry into destination (at least packageEntry.size bytes)
+	bool ReadAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, char* destination);
+	// Decompresses an entry whose stored bytes are already in memory into a new asset
+	bool DecodeAsset(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, const char* source, AssetData& asset);
+	// Decompresses size bytes starting at offset of an entry into destination
+	bool ReadAssetRange(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry, uint64_t offset, uint64_t size, char* destination);
+	// Adds the assets of a package mounted with the highest priority to the indexes, the caller has to hold _mountMutex exclusively
+	void AddToIndex(const MountedPackage& mountedPackage);
+	// Removes the assets of a package that is no longer in _mountOrder, falling back to the assets of lower priority packages
+	void RemoveFromIndex(const MountedPackage& mountedPackage);
+	// Finds the entry with the highest priority, the caller has to hold _mountMutex
+	bool FindAssetByGuid(const std::string& guid, const MountedPackage*& mountedPackage, const PackageTOCEntry*& tocEntry) const;
+
+	AsyncPackageReader& GetAsyncReader();
+	// Locks _mountMutex exclusively once no async loads are in flight
+	std::unique_lock<std::shared_mutex> LockForUnmount();
+	// Called once the completion of an async load has returned
+	void FinishAsyncLoad();
+	// Adds a loaded asset to the access order if recording
+	void RecordAccess(const MountedPackage& mountedPackage, const PackageTOCEntry& tocEntry);
 
 public:
 	PackageManager() = default;
 	~PackageManager() = default;
 
 	// Creates a package from a directory specified by source (path) inside directory specified by target (path)
-	bool Pack(const std::string& source, const std::string& target);
+	// Files listed in layoutManifest (see StopAccessRecording) are placed first, in the order of the manifest
+	// An existing package is updated: only new and changed files are compressed, the rest is copied from it
+	bool Pack(const std::string& source, const std::string& target, const std::string& layoutManifest = "");
+	// Creates a package named <source name>_patch.gepak inside target holding only the files of source that are new
+	// or changed compared to basePackage, mounted after the base package its entries take priority
+	// Files deleted from source are not represented, they can still be loaded from the base package
+	bool PackPatch(const std::string& source, const std::string& basePackage, const std::string& target);
+	// True if the package at path package was packed from the current content of the directory source
+	// Only the header and the file sizes and write times are read, no file content
+	// A package whose source directory does not exist (e.g. shipped without sources) counts as up to date
+	bool IsPackageUpToDate(const std::string& source, const std::string& package) const;
 	// Creates a directory from a package specifed by source (path) inside directory specifed by target (path)
 	bool Unpack(const std::string& source, const std::string& target);
 
 	// Mounts the package at the path source
-	bool MountPackage(const std::string& source);
+	bool MountPackage(const std::string& source, PackageMountMode mode = MAP_PACKAGES ? PackageMountMode::Mapped : PackageMountMode::Stream);
 	// Unmounts the package mounted most recently
 	bool UnmountPackage();
 	// Unmount the package specifed by packageKey
@@ -77,8 +236,61 @@ public:
 	// Loads asset specified by key (path relative to the package that holds it)
 	bool LoadAssetByKey(const std::string& key, AssetData& asset);
 
+	// Loads the assets of all GUIDs, sorted by their offsets so neighbouring entries are read with one large sequential read
+	// The next read runs while the assets of the previous one are decompressed
+	// loaded is called on the calling thread for every asset in file order, it must not mount or unmount packages
+	// Returns false if any asset could not be loaded (the others are still loaded)
+	bool LoadAssets(const std::vector<std::string>& guids, const std::function<void(const std::string& guid, AssetData& asset)>& loaded);
+
+	// Loads asset specified by GUID without blocking, completed is called on an I/O thread once the asset is loaded or the load failed
+	// Returns false without calling completed if the asset is not in a mounted package
+	// Unmounting waits for the loads in flight, so completed must not unmount packages
+	bool LoadAssetByGuidAsync(const std::string& guid, std::function<void(bool loaded, AssetData& asset)> completed);
+	// Waits until the completions of all async loads have been called
+	void WaitForAsyncLoads();
+
+	// Gets the uncompressed size of an asset (the size a destination buffer needs)
+	bool GetAssetSizeByGuid(const std::string& guid, uint64_t& size);
+	// Loads asset specified by GUID into memory returned by allocate, which is called once with the asset size
+	// If allocate returns nullptr the load fails
+	bool LoadAssetByGuid(const std::string& guid, const std::function<void*(uint64_t size)>& allocate, uint64_t& size);
+	// Loads asset specified by GUID into a caller-supplied buffer, fails if the buffer is too small
+	bool LoadAssetByGuid(const std::string& guid, void* buffer, uint64_t bufferSize, uint64_t& size);
+	// Loads size bytes starting at offset of an asset into buffer, only the chunks holding the range are read and decompressed
+	bool LoadAssetRangeByGuid(const std::string& guid, uint64_t offset, uint64_t size, void* buffer);
+	// Loads asset specified by GUID into memory requested from an allocator (e.g. the stack or buddy allocator of a level)
+	template<typename AllocatorType>
+	bool LoadAssetByGuid(const std::string& guid, AllocatorType& allocator, void*& data, uint64_t& size, Tag tag = "Assets");
+
+	// Starts recording the order in which assets are loaded (e.g. while playing through a level)
+	void StartAccessRecording();
+	// Stops recording and writes the keys of the loaded assets in first-use order to path, one per line
+	// The file is used as the layout manifest of Pack, so the assets of a level are read front to back
+	bool StopAccessRecording(const std::string& path);
+
+	// Lets the OS start reading a whole mounted package in the background (e.g. before loading all of its assets)
+	bool PrefetchPackage(const std::string& packageKey);
+
+	// Finds content stored in more than one mounted package (or more than once in one), largest waste first
+	std::vector<DuplicateContent> FindDuplicateContent();
+
+	// True if a package with the key packageKey (file name without extension) is mounted
+	bool IsPackageMounted(const std::string& packageKey);
 	// Get the thread loaded package to load all resources
 	std::vector<std::string> GetGUIDsInPackage(const std::string& packageKey);
 	// Gets all GUID's in the package with the highest priority
 	std::vector<std::string> GetGUIDsInLastMountedPackage();
-};
\ No newline at end of file
+};
+
+template<typename AllocatorType>
+bool PackageManager::LoadAssetByGuid(const std::string& guid, AllocatorType& allocator, void*& data, uint64_t& size, Tag tag)
+{
+	data = nullptr;
+	return LoadAssetByGuid(guid, [&](uint64_t assetSize) -> void* {
+		if (assetSize > UINT32_MAX) {
+			return nullptr;
+		}
+		data = allocator.Request(static_cast<unsigned int>(assetSize), tag);
+		return data;
+	}, size);
+}
@@ -3,11 +3,18 @@
 #include <malloc.h>
 #include <iostream>
 
-int PoolAllocator::_nextId = 0; // Set the initial id
+template <typename Tracking>
+int BasicPoolAllocator<Tracking>::_nextId = 0; // Set the initial id
 
-bool PoolAllocator::InitBlock(Block *block)
+template <typename Tracking>
+bool BasicPoolAllocator<Tracking>::InitBlock(Block *block)
 {
-	if (_aligned) {
+	if (_hugePages) {
+		if (ArenaMemory::Allocate(block->arena, static_cast<size_t>(_n) * _size, true)) {
+			block->address = block->arena.memory;
+		}
+	}
+	else if (_aligned) {
 		block->address = _aligned_malloc(static_cast<size_t>(_n * _size), _size);
 	}
 	else {
@@ -21,7 +28,15 @@ bool PoolAllocator::InitBlock(Block *block)
 	block->nodes = (Node*)malloc(static_cast<size_t>(_n) * sizeof(Node));
 	if (!block->nodes) {
 		std::cerr << "PoolAllocator::InitBlock(): failed to allocate nodes" << std::endl;
-		free(block->address);
+		if (_hugePages) {
+			ArenaMemory::Free(block->arena);
+		}
+		else if (_aligned) {
+			_aligned_free(block->address);
+		}
+		else {
+			free(block->address);
+		}
 		block->address = nullptr;
 		return false;
 	}
@@ -37,7 +52,8 @@ bool PoolAllocator::InitBlock(Block *block)
 	return true;
 }
 
-bool PoolAllocator::Expand()
+template <typename Tracking>
+bool BasicPoolAllocator<Tracking>::Expand()
 {
 	Block newBlock;
 	if (!InitBlock(&newBlock)) {
@@ -50,7 +66,8 @@ bool PoolAllocator::Expand()
 	return true;
 }
 
-PoolStats PoolAllocator::GetStats()
+template <typename Tracking>
+PoolStats BasicPoolAllocator<Tracking>::GetStats()
 {
 	PoolStats stats;
 	stats.capacity = _n * _size * _blocks.size();
@@ -64,10 +81,14 @@ PoolStats PoolAllocator::GetStats()
 	return stats;
 }
 
-PoolAllocator::~PoolAllocator()
+template <typename Tracking>
+BasicPoolAllocator<Tracking>::~BasicPoolAllocator()
 {
 	for (Block& block : _blocks) {
-		if (_aligned) {
+		if (_hugePages) {
+			ArenaMemory::Free(block.arena);
+		}
+		else if (_aligned) {
 			_aligned_free(block.address);
 		}
 		else {
@@ -79,16 +100,18 @@ PoolAllocator::~PoolAllocator()
 		block.nodes = nullptr;
 	}
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().RemoveAllocator(_id, Allocator::Pool);
-	}
+	Tracking::RemoveAllocator(_id, Allocator::Pool);
 }
 
-bool PoolAllocator::Init(int n, int size, bool aligned)
+template <typename Tracking>
+bool BasicPoolAllocator<Tracking>::Init(int n, int size, bool aligned, bool hugePages)
 {
 	_n = n;
 	_size = size;
 	_aligned = aligned;
+	// Huge pages are only used for blocks of at least one huge page, smaller blocks would each reserve a whole 2 MiB page
+	// Huge page arenas are 2 MiB aligned, which is enough for aligned pools with (power of two) slots of up to 2 MiB
+	_hugePages = hugePages && static_cast<size_t>(n) * size >= HUGE_PAGE_SIZE && (!aligned || static_cast<size_t>(size) <= HUGE_PAGE_SIZE);
 
 	Block block;
 	if (!InitBlock(&block)) {
@@ -104,14 +127,13 @@ bool PoolAllocator::Init(int n, int size, bool aligned)
 	_id = _nextId;
 	_nextId++;
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().TrackAllocator(_id, GetStats());
-	}
+	Tracking::TrackAllocator(_id, GetStats());
 
 	return true;
 }
 
-void *PoolAllocator::Request(std::string tag)
+template <typename Tracking>
+void *BasicPoolAllocator<Tracking>::Request(Tag tag)
 {
 	// Should use Expand() to create a new block if all current blocks are full
 	// Additionally, new allocations should be placed in the first block with empty slots :)
@@ -150,9 +172,7 @@ void *PoolAllocator::Request(std::string tag)
 		int memorySpace = index * _size;
 		void* ptr = static_cast<char*>(block.address) + memorySpace;
 
-		if (TRACK_MEMORY) {
-			MemoryTracker::Instance().StartTracking(Allocator::Pool, _id, ptr, _size, tag);
-		}
+		Tracking::StartTracking(Allocator::Pool, _id, ptr, _size, tag);
 
 		return ptr;
 	}
@@ -160,7 +180,8 @@ void *PoolAllocator::Request(std::string tag)
 	return nullptr;
 }
 
-bool PoolAllocator::Free(void *ptr)
+template <typename Tracking>
+bool BasicPoolAllocator<Tracking>::Free(void *ptr)
 {
 	if (ptr == nullptr) {
 		std::cerr << "PoolAllocator::Free(): input pointer is nullptr" << std::endl;
@@ -199,9 +220,7 @@ bool PoolAllocator::Free(void *ptr)
 
 		block.numUsed -= 1;
 
-		if (TRACK_MEMORY) {
-			MemoryTracker::Instance().StopTracking(ptr);
-		}
+		Tracking::StopTracking(ptr);
 
 		return true;
 	}
@@ -211,18 +230,24 @@ bool PoolAllocator::Free(void *ptr)
 	return false;
 }
 
-bool PoolAllocator::GetUsed(int index) {
+template <typename Tracking>
+bool BasicPoolAllocator<Tracking>::GetUsed(int index) {
 	int i = index % _n;
 	int k = index / _n;
 	return _blocks[k].nodes[i].free;
 }
 
-int PoolAllocator::GetNumSlots()
+template <typename Tracking>
+int BasicPoolAllocator<Tracking>::GetNumSlots()
 {
 	return _n * _blocks.size();
 }
 
 // Debug
-void* PoolAllocator::GetAdress(size_t index) {
+template <typename Tracking>
+void* BasicPoolAllocator<Tracking>::GetAdress(size_t index) {
 	return _blocks.at(index).address;
 }
+
+template class BasicPoolAllocator<MemoryTracking>;
+template class BasicPoolAllocator<NoTracking>;
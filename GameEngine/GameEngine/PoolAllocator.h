@@ -1,5 +1,7 @@
 #pragma once
 #include "MemoryTracker.h"
+#include "TrackingPolicy.h"
+#include "ArenaMemory.h"
 #include "Settings.h"
 #include <vector>
 #include <string>
@@ -10,13 +12,16 @@ struct Node {
 };
 
 struct Block {
+	Arena arena;	// Only used when the pool is backed by huge pages
 	void* address = nullptr;
 	Node* nodes = nullptr;	// Pool slots tracker
 	int numUsed;	// Number of free nodes (used for memory tracking)
 	int head ;	// Index of the first free slot (-1 means no empty slots)
 };
 
-class PoolAllocator
+// Tracking is a tracking policy (MemoryTracking or NoTracking, see TrackingPolicy.h)
+template <typename Tracking>
+class BasicPoolAllocator
 {
 private:
 	int _id = -1; // Allocator id (-1 = uninitialized)
@@ -28,6 +33,7 @@ private:
 	int _size = -1;	// Size of the slots in the pool (-1 = uninitialized)
 
 	bool _aligned = false;
+	bool _hugePages = false;
 
 	// Initializes a new, empty block
 	bool InitBlock(Block *block);
@@ -36,17 +42,18 @@ private:
 	bool Expand();
 
 public:
-	PoolAllocator() = default;
-	~PoolAllocator();
+	BasicPoolAllocator() = default;
+	~BasicPoolAllocator();
 
 	int GetId() {
 		return _id;
 	}
 
 	// If aligned is true, initial memory is set on size % = 0
-	bool Init(int n, int size, bool aligned = false);
+	// If hugePages is true, blocks of at least HUGE_PAGE_SIZE are backed by huge pages when the OS allows it
+	bool Init(int n, int size, bool aligned = false, bool hugePages = HUGE_PAGE_ARENAS);
 	// Get the first free slot
-	void *Request(std::string tag = "No tag");
+	void *Request(Tag tag = Tags::NoTag);
 	bool Free(void *ptr);
 
 	// Memory tracking
@@ -62,3 +69,5 @@ public:
 	void* GetAdress(size_t index);
 };
 
+using PoolAllocator = BasicPoolAllocator<DefaultTracking>;
+using UntrackedPoolAllocator = BasicPoolAllocator<NoTracking>;
@@ -2,6 +2,9 @@
 #include "GuidUtils.h"
 #include "TextureResource.h"
 #include "MeshResource.h"
+#include "Settings.h"
+
+#include <filesystem>
 
 ResourceManager::ResourceManager() {
 	workerThread.emplace_back(&ResourceManager::WorkerThread, this);
@@ -31,13 +34,18 @@ bool ResourceManager::LoadResource(std::string guid, Resource *&resource) {
 	}
 	else {
 		// Resource does not exist in cache -> load it from mounted package
+		if (_limitMemory && MemoryTracker::Instance().GetBudgetLevel(_memoryTag.id) == BudgetLevel::Hard) {
+			std::cerr << "ResourceManager::LoadResource(): Memory limit reached: " << _memoryUsed << " of " << _memoryLimit << " bytes used" << std::endl;
+			return false;
+		}
+
 		AssetData data;
 		if (!_packageManager.LoadAssetByGuid(guid, data)) {
 			std::cerr << "ResourceManager::LoadResource(): Could not load resource data from package" << std::endl;
 			return false;
 		}
 
-		if (!resource->LoadFromData(data.data.get(), data.size, data.fileExtension)) {
+		if (!resource->LoadFromData(data.GetData(), data.size, data.fileExtension)) {
 			std::cerr << "ResourceManager::LoadResource(): Could not load resource from raw data" << std::endl;
 			return false;
 		}
@@ -45,11 +53,7 @@ bool ResourceManager::LoadResource(std::string guid, Resource *&resource) {
 		resource->RefAdd();
 		_cachedResources.emplace(guid, resource);
 		_memoryUsed += resource->GetMemoryUsage();
-
-		// Memory limit warning
-		if (_limitMemory && (_memoryUsed >= _memoryLimit)) {
-			std::cerr << "Warning: ResourceManager memory limit reached: " << _memoryUsed << " of " << _memoryLimit << " bytes used" << std::endl;
-		}
+		MemoryTracker::Instance().SetExternalUsage(_memoryTag, _memoryUsed);
 
 		return true;
 	}
@@ -65,6 +69,7 @@ bool ResourceManager::UnloadResource(std::string guid) {
 	if (ref <= 1) {
 		// References goes to 0 -> remove resource from cache
 		_memoryUsed -= _cachedResources[guid]->GetMemoryUsage();
+		MemoryTracker::Instance().SetExternalUsage(_memoryTag, _memoryUsed);
 		_cachedResources[guid]->Unload();
 		_cachedResources.erase(guid);
 		return true;
@@ -85,15 +90,30 @@ PackageManager *ResourceManager::GetPackageManager()
 	return &_packageManager;
 }
 
+void ResourceManager::UpdateMemoryBudget()
+{
+	if (!_limitMemory) {
+		MemoryTracker::Instance().RemoveBudget(_memoryTag.id);
+		return;
+	}
+
+	MemoryBudget budget;
+	budget.soft = (size_t)(_memoryLimit * BUDGET_SOFT_FRACTION);
+	budget.hard = (size_t)_memoryLimit;
+	MemoryTracker::Instance().SetBudget(_memoryTag, budget);
+}
+
 void ResourceManager::EnableMemoryLimit(uint64_t limit)
 {
 	_limitMemory = true;
 	_memoryLimit = limit;
+	UpdateMemoryBudget();
 }
 
 void ResourceManager::DisableMemoryLimit()
 {
 	_limitMemory = false;
+	UpdateMemoryBudget();
 }
 
 uint64_t ResourceManager::GetMemoryLimit()
@@ -104,6 +124,7 @@ uint64_t ResourceManager::GetMemoryLimit()
 void ResourceManager::SetMemoryLimit(uint64_t limit)
 {
 	_memoryLimit = limit;
+	UpdateMemoryBudget();
 }
 
 uint64_t ResourceManager::GetMemoryUsed()
@@ -124,31 +145,36 @@ void ResourceManager::WorkerThread() {
 		std::string package;
 		{
 			std::unique_lock<std::mutex> lock(_packageMutex);
-			if (_newPackage.empty())
+			if (_newPackage.empty()) {
+				lock.unlock();
 				std::this_thread::sleep_for(std::chrono::milliseconds(1));
 				continue;
+			}
 			package = std::move(_newPackage.front());
 			_newPackage.erase(_newPackage.begin());
 		}
 #ifdef TEST
 		auto t0 = std::chrono::high_resolution_clock::now();
 #endif		
-		if (!_packageManager.MountPackage(package)) {
+		// Packages mounted at startup only have their assets loaded
+		std::string packageKey = std::filesystem::path(package).stem().generic_string();
+		if (!_packageManager.IsPackageMounted(packageKey) && !_packageManager.MountPackage(package)) {
 				std::cerr << "ResourceManager::MountPackage(): Could not mount package" << std::endl;
+				continue;
 			}
 			
-			std::vector<std::string> guids = _packageManager.GetGUIDsInLastMountedPackage();
-
-			for (const std::string& guid : guids) {
+			std::vector<std::string> guids = _packageManager.GetGUIDsInPackage(packageKey);
 
-				AssetData data;
-				if (!_packageManager.LoadAssetByGuid(guid, data)) {
-					std::cerr << "ResourceManager::LoadResource(): Could not load resource" << std::endl;
+			// Every asset of the package is loaded, let the OS read it ahead
+			_packageManager.PrefetchPackage(packageKey);
 
-				}
+			// Loaded in file order with large sequential reads
+			bool loaded = _packageManager.LoadAssets(guids, [this](const std::string& guid, AssetData& data) {
 				std::lock_guard<std::mutex> lock(_threadDataMutex);
 				_threadData.emplace(guid, std::move(data));
-				
+			});
+			if (!loaded) {
+				std::cerr << "ResourceManager::LoadResource(): Could not load all resources of " << package << std::endl;
 			}
 #ifdef TEST
 		auto t1 = std::chrono::high_resolution_clock::now();
@@ -183,7 +209,7 @@ bool ResourceManager::LoadObject(Resource* &resource) {
 		_threadData.erase(it);
 	
 	}
-	resource->LoadFromData(data.data.get(), data.size, data.fileExtension);
+	resource->LoadFromData(data.GetData(), data.size, data.fileExtension);
 	_cachedResources.emplace(guid, resource);
 #ifdef TEST
 	auto t1 = std::chrono::high_resolution_clock::now();
@@ -8,6 +8,7 @@
 #include <iostream>
 #include "Resource.h"
 #include "PackageManager.h"
+#include "MemoryTracker.h"
 #include <thread>
 #include <chrono>
 
@@ -22,8 +23,12 @@ class ResourceManager
 {
 private:
 	bool _limitMemory = false;
-	uint64_t _memoryLimit;
-	uint64_t _memoryUsed;
+	uint64_t _memoryLimit = 0;
+	uint64_t _memoryUsed = 0;
+
+	// Resource memory is reported to the MemoryTracker under this tag, the memory limit is its budget
+	static constexpr Tag _memoryTag = "Resources";
+	void UpdateMemoryBudget();
 
 	std::vector<std::string> _newPackage;
 	std::vector<std::thread> workerThread;
@@ -60,6 +65,7 @@ public:
 	PackageManager *GetPackageManager();
 
 	// Enables and sets memory limit (in bytes)
+	// Pressure callbacks are notified from BUDGET_SOFT_FRACTION of the limit, new resources are refused at the limit
 	void EnableMemoryLimit(uint64_t memoryLimit);
 	// Disables memory limit
 	void DisableMemoryLimit();
@@ -23,6 +23,13 @@ Scene::~Scene()
 		}
 		delete _stack;
 	}
+	if (_compacting) {
+		for (size_t i = 0; i < _entities.size(); i++) {
+			_entities[i]->~Entity();
+			_compacting->Free(_handles[i]);
+		}
+		delete _compacting;
+	}
 }
 
 bool Scene::Init(Vector3 pos, std::string path) {
@@ -49,6 +56,14 @@ void Scene::SetLoaded(bool val) {
 	_loaded.store(val);
 }
 
+bool Scene::IsPackageReady() {
+	return _packageReady.load();
+}
+
+void Scene::SetPackageReady(bool val) {
+	_packageReady.store(val);
+}
+
 std::string Scene::GetPath() {
 	SetLoaded(true);
 	return _pathToPackage;
@@ -59,11 +74,34 @@ void Scene::AddEntity(Entity *entity)
 	_entities.push_back(entity);
 }
 
+void Scene::AddEntity(Entity *entity, CompactingHandle handle)
+{
+	_entities.push_back(entity);
+	_handles.push_back(handle);
+}
+
 std::vector<Entity *>& Scene::GetEntities()
 {
 	return _entities;
 }
 
+void Scene::DestroyEntity(size_t index)
+{
+	Entity *ent = _entities[index];
+	ent->~Entity();
+	if (_pool) {
+		_pool->Free(ent);
+	}
+	if (_buddy) {
+		_buddy->Free(ent);
+	}
+	if (_compacting) {
+		_compacting->Free(_handles[index]);
+		_handles.erase(_handles.begin() + index);
+	}
+	_entities.erase(_entities.begin() + index);
+}
+
 void Scene::DestroyEntities()
 {
 	if (_pool) {
@@ -84,12 +122,32 @@ void Scene::DestroyEntities()
 		}
 		_stack->Reset();
 	}
+	if (_compacting) {
+		for (size_t i = 0; i < _entities.size(); i++) {
+			_entities[i]->~Entity();
+			_compacting->Free(_handles[i]);
+		}
+		_handles.clear();
+	}
 	_entities.clear();
 }
 
+unsigned int Scene::Defragment(unsigned int maxBytes)
+{
+	if (!_compacting || _compacting->IsCompacted()) {
+		return 0;
+	}
+
+	unsigned int moved = _compacting->Defragment(maxBytes);
+	for (size_t i = 0; i < _entities.size(); i++) {
+		_entities[i] = (Entity *)_compacting->Get(_handles[i]);
+	}
+	return moved;
+}
+
 PoolAllocator *Scene::GetPoolAllocator()
 {
-	if (!_pool && !_buddy && !_stack) { // There can only be one allocator per ScenePart
+	if (!_pool && !_buddy && !_stack && !_compacting) { // There can only be one allocator per ScenePart
 		_pool = new PoolAllocator;
 	}
 	return _pool;
@@ -97,7 +155,7 @@ PoolAllocator *Scene::GetPoolAllocator()
 
 BuddyAllocator *Scene::GetBuddyAllocator()
 {
-	if (!_pool && !_buddy && !_stack) { // There can only be one allocator per ScenePart
+	if (!_pool && !_buddy && !_stack && !_compacting) { // There can only be one allocator per ScenePart
 		_buddy = new BuddyAllocator;
 	}
 	return _buddy;
@@ -105,12 +163,20 @@ BuddyAllocator *Scene::GetBuddyAllocator()
 
 StackAllocator *Scene::GetStackAllocator()
 {
-	if (!_pool && !_buddy && !_stack) { // There can only be one allocator per ScenePart
+	if (!_pool && !_buddy && !_stack && !_compacting) { // There can only be one allocator per ScenePart
 		_stack = new StackAllocator;
 	}
 	return _stack;
 }
 
+CompactingAllocator *Scene::GetCompactingAllocator()
+{
+	if (!_pool && !_buddy && !_stack && !_compacting) { // There can only be one allocator per ScenePart
+		_compacting = new CompactingAllocator;
+	}
+	return _compacting;
+}
+
 int Scene::CheckLastFrame() {
 	return _lastFrame;
 }
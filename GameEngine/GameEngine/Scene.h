@@ -8,6 +8,7 @@
 #include "PoolAllocator.h"
 #include "BuddyAllocator.h"
 #include "StackAllocator.h"
+#include "CompactingAllocator.h"
 
 // This is a class that Scene will hold to demonstrate asynchronous loading
 
@@ -16,13 +17,16 @@ private:
 	std::string _pathToPackage;
 	Vector3 _centerPos = { 0,0,0 };
 	std::atomic<bool> _loaded{ false };
+	std::atomic<bool> _packageReady{ true }; // False while the package is being packed
 	int _lastFrame = 0;
 
 	std::vector<Entity *> _entities;
+	std::vector<CompactingHandle> _handles; // Allocations of the entities in the compacting allocator (same order as _entities)
 
 	PoolAllocator *_pool = nullptr;
 	BuddyAllocator *_buddy = nullptr;
 	StackAllocator *_stack = nullptr;
+	CompactingAllocator *_compacting = nullptr;
 
 public:
 	Scene() = default;
@@ -32,15 +36,25 @@ public:
 	bool CheckDistance(Vector3 camera);
 	bool IsLoaded();
 	void SetLoaded(bool val);
+	bool IsPackageReady();
+	void SetPackageReady(bool val);
 	int CheckLastFrame();
 	void SetLastFrame(int frame);
 	std::string GetPath();
 
 	void AddEntity(Entity *entity);
+	// Adds an entity allocated in the compacting allocator
+	void AddEntity(Entity *entity, CompactingHandle handle);
 	std::vector<Entity *>& GetEntities();
+	// Destroys the entity at index and frees it from the scene allocator
+	void DestroyEntity(size_t index);
 	void DestroyEntities();
+	// Moves at most maxBytes of entities in the compacting allocator and updates the entity pointers
+	// Entities must be requested with CompactingAllocator::Request<T>() so they are relocated by move construction
+	unsigned int Defragment(unsigned int maxBytes);
 
 	PoolAllocator *GetPoolAllocator();
 	BuddyAllocator *GetBuddyAllocator();
 	StackAllocator *GetStackAllocator();
+	CompactingAllocator *GetCompactingAllocator();
 };
\ No newline at end of file
@@ -7,8 +7,10 @@
 
 #include "WinFileDialog.h"
 #include <chrono>
+#include <algorithm>
 
 #include "ResourceManager.h"
+#include "HeapTracking.h"
 #include "MeshResource.h"
 #include "TextureResource.h"
 
@@ -80,7 +82,6 @@ bool SceneManager::RenderInterface()
 		ImGui::TextColored(ImVec4(0, 1, 0, 1), "MEMORY TRACKER");
 
 		MemoryTracker& tracker = MemoryTracker::Instance();
-		auto allAllocations = tracker.GetAllocations();
 
 		// --- HELPER LAMBDAS ---
 		auto FormatBytes = [](size_t bytes) -> std::string {
@@ -90,41 +91,218 @@ bool SceneManager::RenderInterface()
 			return ss.str();
 			};
 
+		// Only the visible rows are copied out of the tracker so the list stays cheap with many allocations
+		std::vector<Allocation> page;
+		std::vector<float> history;
 		auto RenderAllocationList = [&](Allocator type, int id) {
 			ImGui::PushID((int)type * 1000 + id); // Scope per allocator instance
 
-			if (ImGui::TreeNode("Live Allocations")) {
-				bool foundAny = false;
-				int i = 0;
-				for (auto& [ptr, alloc] : allAllocations) {
-					if (alloc.allocator == type && alloc.allocatorId == id) {
-						foundAny = true;
-						ImGui::PushID(i++);
-
-						std::string tag = alloc.tag.empty() ? "Untitled" : alloc.tag;
-						ImGui::TextColored(ImVec4(0.6f, 1.0f, 1.0f, 1.0f), "%s", tag.c_str());
-						ImGui::SameLine();
-						ImGui::TextDisabled("(%p)", ptr);
-
-						ImGui::Indent();
-						ImGui::Text("Size: %s", FormatBytes(alloc.size).c_str());
-
-						std::time_t t = std::chrono::system_clock::to_time_t(alloc.timestamp);
-						char timeBuf[26]; ctime_s(timeBuf, sizeof(timeBuf), &t);
-						timeBuf[std::strlen(timeBuf) - 1] = '\0';
-						ImGui::TextDisabled("Time: %s", timeBuf);
-
-						ImGui::Unindent();
-						ImGui::PopID();
-						ImGui::Separator();
+			tracker.GetAllocatorHistory(type, id, history);
+			if (!history.empty()) {
+				ImGui::PlotLines("##History", history.data(), (int)history.size(), 0, "Tracked bytes", 0.0f, FLT_MAX, ImVec2(-1.0f, 40.0f));
+			}
+
+			AllocationCounters counters = tracker.GetAllocatorCounters(type, id);
+			char label[64];
+			sprintf_s(label, "Live Allocations (%zu)###Live", counters.count);
+			if (ImGui::TreeNode(label)) {
+				if (counters.count == 0) {
+					ImGui::TextDisabled("No active allocations.");
+				}
+				else if (ImGui::BeginTable("Allocations", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV, ImVec2(0.0f, ImGui::GetTextLineHeightWithSpacing() * 12))) {
+					ImGui::TableSetupScrollFreeze(0, 1);
+					ImGui::TableSetupColumn("Tag");
+					ImGui::TableSetupColumn("Address");
+					ImGui::TableSetupColumn("Size");
+					ImGui::TableSetupColumn("Time");
+					ImGui::TableHeadersRow();
+
+					ImGuiListClipper clipper;
+					clipper.Begin((int)counters.count);
+					while (clipper.Step()) {
+						tracker.GetAllocations(type, id, clipper.DisplayStart, clipper.DisplayEnd - clipper.DisplayStart, page);
+						for (const Allocation& alloc : page) {
+							ImGui::TableNextRow();
+							ImGui::TableNextColumn();
+							ImGui::TextColored(ImVec4(0.6f, 1.0f, 1.0f, 1.0f), "%s", tracker.GetTagName(alloc.tag).c_str());
+							ImGui::TableNextColumn();
+							ImGui::TextDisabled("%p", alloc.ptr);
+							ImGui::TableNextColumn();
+							ImGui::Text("%s", FormatBytes(alloc.size).c_str());
+
+							std::time_t t = std::chrono::system_clock::to_time_t(alloc.timestamp);
+							char timeBuf[26]; ctime_s(timeBuf, sizeof(timeBuf), &t);
+							timeBuf[std::strlen(timeBuf) - 1] = '\0';
+							ImGui::TableNextColumn();
+							ImGui::TextDisabled("%s", timeBuf);
+						}
 					}
+					ImGui::EndTable();
 				}
-				if (!foundAny) ImGui::TextDisabled("No active allocations.");
 				ImGui::TreePop();
 			}
 			ImGui::PopID();
 			};
 
+		AllocationCounters totals = tracker.GetTotals();
+		ImGui::Text("Live: %zu allocations, %s (peak %s)", totals.count, FormatBytes(totals.bytes).c_str(), FormatBytes(totals.peakBytes).c_str());
+
+		if (ImGui::CollapsingHeader("Budgets")) {
+			auto budgets = tracker.GetBudgets();
+			if (budgets.empty()) {
+				ImGui::TextDisabled("No budgets set.");
+			}
+
+			for (size_t i = 0; i < budgets.size(); i++) {
+				const BudgetEvent& budget = budgets[i];
+				ImGui::PushID((int)i);
+
+				std::string name = budget.isTag ? tracker.GetTagName(budget.tag) : std::string(GetAllocatorName(budget.allocator)) + " " + std::to_string(budget.allocatorId);
+				ImGui::Text("%s (soft %s, hard %s)", name.c_str(), FormatBytes(budget.budget.soft).c_str(), FormatBytes(budget.budget.hard).c_str());
+
+				ImVec4 color = budget.level == BudgetLevel::Hard ? ImVec4(0.9f, 0.2f, 0.2f, 1.0f)
+					: budget.level == BudgetLevel::Soft ? ImVec4(0.9f, 0.7f, 0.2f, 1.0f) : ImVec4(0.2f, 0.8f, 0.2f, 1.0f);
+				size_t limit = budget.budget.hard > 0 ? budget.budget.hard : budget.budget.soft;
+				float fraction = limit > 0 ? std::min(1.0f, (float)budget.bytes / (float)limit) : 0.0f;
+
+				ImGui::PushStyleColor(ImGuiCol_PlotHistogram, color);
+				ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), FormatBytes(budget.bytes).c_str());
+				ImGui::PopStyleColor();
+				ImGui::PopID();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Timeline")) {
+			std::vector<float> liveBytes;
+			std::vector<float> allocations;
+			tracker.GetFrameHistory(liveBytes, allocations);
+
+			if (!liveBytes.empty()) {
+				ImGui::PlotLines("##LiveBytes", liveBytes.data(), (int)liveBytes.size(), 0, "Live bytes", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+				ImGui::PlotHistogram("##Allocations", allocations.data(), (int)allocations.size(), 0, "Allocations per frame", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+			}
+
+			if (ImGui::Button("Export Chrome Trace")) {
+				tracker.ExportChromeTrace("memory_timeline.json");
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Export CSV")) {
+				tracker.ExportTimelineCsv("memory_events.csv", "memory_frames.csv");
+			}
+		}
+
+		if (HeapTracking::IsEnabled() && ImGui::CollapsingHeader("Heap")) {
+			HeapStats heap = HeapTracking::GetStats();
+			ImGui::Text("Live: %zu allocations, %s (%llu since startup)", heap.count, FormatBytes(heap.bytes).c_str(), (unsigned long long)heap.allocations);
+
+			std::vector<float> heapBytes;
+			std::vector<float> heapAllocations;
+			tracker.GetHeapHistory(heapBytes, heapAllocations);
+			if (!heapBytes.empty()) {
+				ImGui::PlotLines("##HeapBytes", heapBytes.data(), (int)heapBytes.size(), 0, "Heap bytes", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+				ImGui::PlotHistogram("##HeapAllocations", heapAllocations.data(), (int)heapAllocations.size(), 0, "operator new per frame", 0.0f, FLT_MAX, ImVec2(-1.0f, 60.0f));
+			}
+
+			auto heapTags = HeapTracking::GetTagStats();
+			std::sort(heapTags.begin(), heapTags.end(), [](const HeapTagStats& a, const HeapTagStats& b) {
+				return a.bytes > b.bytes;
+			});
+			if (ImGui::BeginTable("HeapTags", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+				ImGui::TableSetupColumn("Scope");
+				ImGui::TableSetupColumn("Live");
+				ImGui::TableSetupColumn("Bytes");
+				ImGui::TableSetupColumn("Total");
+				ImGui::TableHeadersRow();
+				for (const HeapTagStats& tag : heapTags) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", tag.name ? tag.name : "Unknown tag");
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", tag.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", FormatBytes(tag.bytes).c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", (unsigned long long)tag.allocations);
+				}
+				ImGui::EndTable();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Tags")) {
+			auto tagCounters = tracker.GetTagCounters();
+			std::sort(tagCounters.begin(), tagCounters.end(), [](const auto& a, const auto& b) {
+				return a.second.bytes > b.second.bytes;
+			});
+
+			if (ImGui::BeginTable("Tags", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+				ImGui::TableSetupColumn("Tag");
+				ImGui::TableSetupColumn("Live");
+				ImGui::TableSetupColumn("Bytes");
+				ImGui::TableSetupColumn("Peak");
+				ImGui::TableHeadersRow();
+				for (auto& [tag, counters] : tagCounters) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", tracker.GetTagName(tag).c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", counters.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", FormatBytes(counters.bytes).c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", FormatBytes(counters.peakBytes).c_str());
+				}
+				ImGui::EndTable();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Lifetimes")) {
+			auto lifetimes = tracker.GetLifetimeHistograms();
+			std::sort(lifetimes.begin(), lifetimes.end(), [](const auto& a, const auto& b) {
+				return a.second.total > b.second.total;
+			});
+
+			ImGui::TextDisabled("Buckets: <1us, then x4 per bucket");
+			for (auto& [tag, histogram] : lifetimes) {
+				ImGui::PushID((int)tag);
+				float buckets[LifetimeHistogram::numBuckets];
+				for (int i = 0; i < LifetimeHistogram::numBuckets; i++) {
+					buckets[i] = (float)histogram.buckets[i];
+				}
+
+				ImGui::Text("%s: %llu freed, %.1f%% within the frame", tracker.GetTagName(tag).c_str(), (unsigned long long)histogram.total,
+					100.0f * histogram.sameFrame / (float)histogram.total);
+				ImGui::PlotHistogram("##Lifetime", buckets, LifetimeHistogram::numBuckets, 0, nullptr, 0.0f, FLT_MAX, ImVec2(-1.0f, 40.0f));
+				ImGui::PopID();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Leaks")) {
+			auto reports = tracker.GetLeakReports();
+			if (reports.empty()) {
+				ImGui::TextDisabled("No allocator has been destroyed with live allocations.");
+			}
+
+			// Newest first
+			for (int i = (int)reports.size() - 1; i >= 0; i--) {
+				const LeakReport& report = reports[i];
+				ImGui::PushID(i);
+
+				std::time_t t = std::chrono::system_clock::to_time_t(report.timestamp);
+				char timeBuf[26]; ctime_s(timeBuf, sizeof(timeBuf), &t);
+				timeBuf[std::strlen(timeBuf) - 1] = '\0';
+
+				if (ImGui::TreeNode("Report", "%s %d: %zu allocations, %s (%s)", GetAllocatorName(report.allocator), report.allocatorId,
+					report.count, FormatBytes(report.bytes).c_str(), timeBuf)) {
+					for (const LeakGroup& group : report.groups) {
+						ImGui::BulletText("%s: %zu allocations, %s, oldest %.1f s, average %.1f s", tracker.GetTagName(group.tag).c_str(),
+							group.count, FormatBytes(group.bytes).c_str(), group.oldestAge, group.averageAge);
+					}
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+		}
+
 		if (ImGui::CollapsingHeader("Stack Allocators")) {
 			ImGui::PushID("Stacks"); // Global Stack Scope
 			for (auto* stack : _stackAllocators) {
@@ -229,12 +407,48 @@ bool SceneManager::RenderInterface()
 			}
 			ImGui::PopID();
 		}
+
+		if (ImGui::CollapsingHeader("Compacting Allocators")) {
+			ImGui::PushID("Compactings"); // Global Compacting Scope
+			for (auto* compacting : _compactingAllocators) {
+				ImGui::PushID(compacting->GetId()); // Instance Scope
+
+				CompactingStats stats = compacting->GetStats();
+				float fraction = (stats.capacity > 0) ? (float)stats.usedMemory / (float)stats.capacity : 0.0f;
+
+				ImGui::Text("Compacting ID: %d | Largest Free Block: %s", compacting->GetId(), FormatBytes(stats.largestFreeBlock).c_str());
+
+				char overlay[32];
+				sprintf_s(overlay, "%.1f%% (%s / %s)", fraction * 100.0f, FormatBytes(stats.usedMemory).c_str(), FormatBytes(stats.capacity).c_str());
+				ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), overlay);
+				compacting->DrawInterface();
+
+				RenderAllocationList(Allocator::Compacting, compacting->GetId());
+
+				ImGui::Separator();
+				ImGui::PopID();
+			}
+			ImGui::PopID();
+		}
 	}
 
 	ImGui::End();
 	return true;
 }
 
+int SceneManager::GetSpawnCount(int count)
+{
+	switch (_spawnPressure.load(std::memory_order_relaxed))
+	{
+	case BudgetLevel::Soft:
+		return count > 1 ? 1 : count;
+	case BudgetLevel::Hard:
+		return 0;
+	default:
+		return count;
+	}
+}
+
 void SceneManager::RenderResources(Entity *ent)
 {
 	Transform *transform = ent->GetTransform();
@@ -276,7 +490,7 @@ void SceneManager::Testing()
 
 	const auto firstTestEnt = _entities.begin();
 	if (_scenes.size() > 0) {
-		if (_scenes[0]->CheckDistance(_camera.position) && !_scenes[0]->IsLoaded()) {
+		if (_scenes[0]->CheckDistance(_camera.position) && !_scenes[0]->IsLoaded() && _scenes[0]->IsPackageReady()) {
 			int numEnemies = 100;
 			ResourceManager::Instance().AddPackage(_scenes[0]->GetPath());
 			_scenes[0]->SetLoaded(true);
@@ -337,6 +551,12 @@ void SceneManager::Testing()
 
 SceneManager::~SceneManager()
 {
+	MemoryTracker::Instance().RemovePressureCallback(_pressureCallback);
+
+	if (_packThread.joinable()) {
+		_packThread.join();
+	}
+
 	for (Entity *ent : _entities) {
 		ent->~Entity();
 		_buddy->Free(ent);
@@ -346,6 +566,7 @@ SceneManager::~SceneManager()
 		PoolAllocator *pool = scene->GetPoolAllocator();
 		BuddyAllocator *buddy = scene->GetBuddyAllocator();
 		StackAllocator *stack = scene->GetStackAllocator();
+		CompactingAllocator *compacting = scene->GetCompactingAllocator();
 
 		if (pool)
 			_poolAllocators.erase(std::find(_poolAllocators.begin(), _poolAllocators.end(), pool));
@@ -353,6 +574,8 @@ SceneManager::~SceneManager()
 			_buddyAllocators.erase(std::find(_buddyAllocators.begin(), _buddyAllocators.end(), buddy));
 		if (stack)
 			_stackAllocators.erase(std::find(_stackAllocators.begin(), _stackAllocators.end(), stack));
+		if (compacting)
+			_compactingAllocators.erase(std::find(_compactingAllocators.begin(), _compactingAllocators.end(), compacting));
 
 		delete scene;
 	}
@@ -366,6 +589,9 @@ SceneManager::~SceneManager()
 	for (BuddyAllocator* allocator : _buddyAllocators) {
 		delete allocator;
 	}
+	for (CompactingAllocator* allocator : _compactingAllocators) {
+		delete allocator;
+	}
 
 	ResourceManager::Instance().GetPackageManager()->UnmountAllPackages();
 }
@@ -380,6 +606,10 @@ bool SceneManager::Init(unsigned int width, unsigned int height)
 	//SetTargetFPS(60);
 	rlImGuiSetup(true);
 
+	if (HeapTracking::IsEnabled() && !HeapTracking::InstallMallocHook()) {
+		std::cout << "SceneManager::Init(): malloc hook unavailable, only operator new is counted" << std::endl;
+	}
+
 	// Initialize the global buddy allocator
 	_buddy->Init(512);
 	_buddyAllocators.emplace_back(_buddy);
@@ -388,15 +618,18 @@ bool SceneManager::Init(unsigned int width, unsigned int height)
 	Mesh floorMesh = GenMeshPlane(40, 40, 1, 1);
 	_floor = LoadModelFromMesh(floorMesh);
 
-	// Pack and mount packages
+	// Mount packages, packages that are missing or older than their source directory are packed in the background
+	PackageManager *packageManager = ResourceManager::Instance().GetPackageManager();
+	std::vector<int> staleLevels;
 	for (int i = 1; i < 4; i++) {
-		std::string packagePath = "Resources/Level" + std::to_string(i);
-		if (!ResourceManager::Instance().GetPackageManager()->Pack(packagePath, "Resources")) {
-			std::cerr << "SceneManager::Init(): Could not pack package:" << packagePath << std::endl;;
+		std::string sourcePath = "Resources/Level" + std::to_string(i);
+		std::string packagePath = sourcePath + ".gepak";
+		if (!packageManager->IsPackageUpToDate(sourcePath, packagePath)) {
+			staleLevels.push_back(i);
+			continue;
 		}
 
-		packagePath += ".gepak";
-		if (!ResourceManager::Instance().GetPackageManager()->MountPackage(packagePath)) {
+		if (!packageManager->MountPackage(packagePath)) {
 			std::cerr << "SceneManager::Init(): Could not load package: " << packagePath << std::endl;
 			return false;
 		}
@@ -411,11 +644,11 @@ bool SceneManager::Init(unsigned int width, unsigned int height)
 		_poolAllocators.emplace_back(lvlPool);
 		_scenes.push_back(level1);
 
-		Scene *level2 = new Scene; // GREEN / BUDDY
+		Scene *level2 = new Scene; // GREEN / COMPACTING
 		level2->Init({ 0, 0, -40 }, "Resources/Level2.gepak");
-		BuddyAllocator *lvlBuddy = level2->GetBuddyAllocator();
-		lvlBuddy->Init(std::pow(2, 12)); // 2048 Bytes
-		_buddyAllocators.emplace_back(lvlBuddy);
+		CompactingAllocator *lvlCompacting = level2->GetCompactingAllocator(); // Entities churn, defragmented every frame
+		lvlCompacting->Init(std::pow(2, 12)); // 4096 Bytes
+		_compactingAllocators.emplace_back(lvlCompacting);
 		_scenes.push_back(level2);
 
 		Scene *level3 = new Scene; // RED / STACK
@@ -426,6 +659,60 @@ bool SceneManager::Init(unsigned int width, unsigned int height)
 		_scenes.push_back(level3);
 	}
 
+	// The scene of a package being packed is not loaded until the package is mounted (the pack thread is its only mounter)
+	if (!staleLevels.empty()) {
+		for (int level : staleLevels) {
+			_scenes[level - 1]->SetPackageReady(false);
+		}
+
+		_packThread = std::thread([packageManager, staleLevels, scenes = _scenes]() {
+			for (int level : staleLevels) {
+				std::string sourcePath = "Resources/Level" + std::to_string(level);
+				if (!packageManager->Pack(sourcePath, "Resources")) {
+					std::cerr << "SceneManager::Init(): Could not pack package:" << sourcePath << std::endl;
+				}
+
+				std::string packagePath = sourcePath + ".gepak";
+				if (!packageManager->MountPackage(packagePath)) {
+					std::cerr << "SceneManager::Init(): Could not load package: " << packagePath << std::endl;
+				}
+				scenes[level - 1]->SetPackageReady(true);
+			}
+		});
+	}
+
+	// Memory budgets of the level allocators
+	{
+		MemoryTracker& tracker = MemoryTracker::Instance();
+		auto MakeBudget = [](unsigned int capacity) {
+			MemoryBudget budget;
+			budget.soft = (size_t)(capacity * BUDGET_SOFT_FRACTION);
+			budget.hard = (size_t)(capacity * BUDGET_HARD_FRACTION);
+			return budget;
+		};
+
+		PoolAllocator *lvlPool = _scenes[0]->GetPoolAllocator();
+		tracker.SetBudget(Allocator::Pool, lvlPool->GetId(), MakeBudget(lvlPool->GetStats().capacity));
+		CompactingAllocator *lvlCompacting = _scenes[1]->GetCompactingAllocator();
+		tracker.SetBudget(Allocator::Compacting, lvlCompacting->GetId(), MakeBudget(lvlCompacting->GetStats().capacity));
+		StackAllocator *lvlStack = _scenes[2]->GetStackAllocator();
+		tracker.SetBudget(Allocator::Stack, lvlStack->GetId(), MakeBudget(lvlStack->GetStats().capacity));
+
+		_pressureCallback = tracker.AddPressureCallback([this](const BudgetEvent& event) {
+			std::cout << "SceneManager: " << (event.isTag ? MemoryTracker::Instance().GetTagName(event.tag) : GetAllocatorName(event.allocator))
+				<< " budget " << (event.level == BudgetLevel::Hard ? "hard limit reached" : event.level == BudgetLevel::Soft ? "soft limit reached" : "back to normal")
+				<< " (" << event.bytes << " bytes)" << std::endl;
+
+			BudgetLevel pressure = BudgetLevel::Normal;
+			for (const BudgetEvent& budget : MemoryTracker::Instance().GetBudgets()) {
+				if (!budget.isTag && budget.level > pressure) {
+					pressure = budget.level;
+				}
+			}
+			_spawnPressure.store(pressure, std::memory_order_relaxed);
+		});
+	}
+
 	// Initialize camera
 	{
 		_camera.position = { 0.0f, 2.0f, 10.0f };
@@ -456,6 +743,9 @@ bool SceneManager::Init(unsigned int width, unsigned int height)
 
 bool SceneManager::Update()
 {
+	// Apply allocation events recorded by all threads since the last frame and sample the allocators for the timeline
+	MemoryTracker::Instance().EndFrame();
+
 	// Memory tracking updates (every 0.5s)
 	static float elapsed = 0;
 	elapsed += GetFrameTime();
@@ -470,6 +760,14 @@ bool SceneManager::Update()
 		for (auto& allocator : _buddyAllocators) {
 			MemoryTracker::Instance().TrackAllocator(allocator->GetId(), allocator->GetStats());
 		}
+		for (auto& allocator : _compactingAllocators) {
+			MemoryTracker::Instance().TrackAllocator(allocator->GetId(), allocator->GetStats());
+		}
+	}
+
+	// Incremental defragmentation (bounded amount of bytes moved each frame), the scenes update their entity pointers
+	for (Scene *scene : _scenes) {
+		scene->Defragment(DEFRAG_BYTES_PER_FRAME);
 	}
 
 	/* 
@@ -518,7 +816,7 @@ bool SceneManager::Update()
 	static float deltaTime = 0;
 	deltaTime += GetFrameTime();
 	if (_scenes.size() > 0 &&
-		_scenes[0]->CheckDistance(_camera.position) && !_scenes[0]->IsLoaded()) {
+		_scenes[0]->CheckDistance(_camera.position) && !_scenes[0]->IsLoaded() && _scenes[0]->IsPackageReady()) {
 		ResourceManager::Instance().AddPackage(_scenes[0]->GetPath());
 		int numEnemies = 5;
 		const int numRow = 10;
@@ -552,7 +850,7 @@ bool SceneManager::Update()
 				entities.erase(entities.begin() + i);
 			}
 		}
-		for (int i = 0; i < 5; i++) {
+		for (int i = 0; i < GetSpawnCount(5); i++) {
 			void* ptr = _scenes[0]->GetPoolAllocator()->Request();
 			EntityEnemy* ent = new (ptr) EntityEnemy;
 			if (!ptr) {
@@ -568,52 +866,53 @@ bool SceneManager::Update()
 		}
 	}
 
-	// GREEN / BUDDY
+	// GREEN / COMPACTING
 	if (_scenes.size() > 1 &&
-		_scenes[1]->CheckDistance(_camera.position) && !_scenes[1]->IsLoaded()) {
+		_scenes[1]->CheckDistance(_camera.position) && !_scenes[1]->IsLoaded() && _scenes[1]->IsPackageReady()) {
 		ResourceManager::Instance().AddPackage(_scenes[1]->GetPath());
 		int numEnemies = 10;
 		const int numRow = 10;
 
+		CompactingAllocator *compacting = _scenes[1]->GetCompactingAllocator();
 		for (int i = 0; i < numEnemies; i++) {
-			void *ptr = nullptr;
+			CompactingHandle handle;
 			if (i % 3 == 0) {
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityGoofy));
-				if (!ptr) {
+				handle = compacting->Request<EntityGoofy>();
+				if (handle.index == UINT32_MAX) {
 					break;
 				}
-				EntityGoofy *ent = new (ptr) EntityGoofy; // Cast the empty memory to an Entity
+				EntityGoofy *ent = new (compacting->Get(handle)) EntityGoofy; // Cast the empty memory to an Entity
 				ent->Init();
 				Transform *t = ent->GetTransform();
 				t->translation.x = (int)(i / numRow) * -20;
 				t->translation.y = 0.0f;
 				t->translation.z = (i % numRow) * -10;
 				t->scale = { 10.0f, 10.0f, 10.0f };
-				_scenes[1]->AddEntity(ent);
+				_scenes[1]->AddEntity(ent, handle);
 			}
 			else if (i % 3 == 1) {
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityEnemy));
-				EntityEnemy *ent = new (ptr) EntityEnemy; // Cast the empty memory to an Entity
-				if (!ptr) {
+				handle = compacting->Request<EntityEnemy>();
+				if (handle.index == UINT32_MAX) {
 					break;
 				}
+				EntityEnemy *ent = new (compacting->Get(handle)) EntityEnemy; // Cast the empty memory to an Entity
 				ent->Init();
 				Transform *t = ent->GetTransform();
 				t->translation.x = (int)(i / numRow) * -5;
 				t->translation.z = (i % numRow) * -5;
-				_scenes[1]->AddEntity(ent);
+				_scenes[1]->AddEntity(ent, handle);
 			}
 			else if (i % 3 == 2) {
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityMushroom));
-				if (!ptr) {
+				handle = compacting->Request<EntityMushroom>();
+				if (handle.index == UINT32_MAX) {
 					break;
 				}
-				EntityMushroom *ent = new (ptr) EntityMushroom;
+				EntityMushroom *ent = new (compacting->Get(handle)) EntityMushroom;
 				ent->Init();
 				Transform *t = ent->GetTransform();
 				t->translation.x = (int)(i / numRow) * -2;
 				t->translation.z = (i % numRow) * -2;
-				_scenes[1]->AddEntity(ent);
+				_scenes[1]->AddEntity(ent, handle);
 			}
 		}
 	}
@@ -627,33 +926,31 @@ bool SceneManager::Update()
 		for (int i = entities.size() - 1; i > 0; i--) {
 			int spawn = rand() % 2;
 			if (spawn == 0) {
-				Entity* ent = entities[i];
-				ent->~Entity();
-				_scenes[1]->GetBuddyAllocator()->Free(ent);
-				entities.erase(entities.begin() + i);
+				_scenes[1]->DestroyEntity(i);
 			}
 		}
-		for (int i = 0; i < 5; i++) {
+		CompactingAllocator *compacting = _scenes[1]->GetCompactingAllocator();
+		for (int i = 0; i < GetSpawnCount(5); i++) {
 			int unit = rand() % 3;
-			void* ptr = nullptr;
+			CompactingHandle handle;
 			Entity* ent = nullptr;
 			switch (unit) {
 			case 0:
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityEnemy));
-				if (!ptr) break;
-				ent = new (ptr) EntityEnemy;
+				handle = compacting->Request<EntityEnemy>();
+				if (handle.index == UINT32_MAX) break;
+				ent = new (compacting->Get(handle)) EntityEnemy;
 				//ent->Init();
 				break;
 			case 1:
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityGoofy));
-				if (!ptr) break;
-				 ent = new (ptr) EntityGoofy;
+				handle = compacting->Request<EntityGoofy>();
+				if (handle.index == UINT32_MAX) break;
+				 ent = new (compacting->Get(handle)) EntityGoofy;
 				//ent->Init();
 				break;
 			case 2:
-				ptr = _scenes[1]->GetBuddyAllocator()->Request(sizeof(EntityMushroom));
-				if (!ptr) break;
-				 ent = new (ptr) EntityMushroom;
+				handle = compacting->Request<EntityMushroom>();
+				if (handle.index == UINT32_MAX) break;
+				 ent = new (compacting->Get(handle)) EntityMushroom;
 				//ent->Init();
 				break;
 			}
@@ -667,14 +964,14 @@ bool SceneManager::Update()
 			float z = rand() % 20;
 			t->translation.x = -(x);
 			t->translation.z = -(z + 40);
-			_scenes[1]->AddEntity(ent);
+			_scenes[1]->AddEntity(ent, handle);
 		}
 	}
 
 	// RED / STACK
 	// Has an extra check for loading since it reloads each frame
 	if (_scenes.size() > 2 &&
-		_scenes[2]->CheckDistance(_camera.position)) {
+		_scenes[2]->CheckDistance(_camera.position) && _scenes[2]->IsPackageReady()) {
 		if (!_scenes[2]->IsLoaded()) {
 			ResourceManager::Instance().AddPackage(_scenes[2]->GetPath());
 
@@ -9,7 +9,10 @@
 #include "PoolAllocator.h"
 #include "StackAllocator.h"
 #include "BuddyAllocator.h"
+#include "CompactingAllocator.h"
+#include <atomic>
 #include <chrono>
+#include <thread>
 struct Middle {
 	float left = 0.0f;
 	float right = 0.0f;
@@ -23,6 +26,7 @@ private:
 	std::vector<PoolAllocator*> _poolAllocators;
 	std::vector<StackAllocator*> _stackAllocators;
 	std::vector<BuddyAllocator*> _buddyAllocators;
+	std::vector<CompactingAllocator*> _compactingAllocators;
 
 	// Global entities
 	BuddyAllocator *_buddy = new BuddyAllocator;
@@ -33,14 +37,23 @@ private:
 	
 	// The scenes hold a package to a "lvl" and a distance. When distance is appropiate run async loading
 	std::vector<Scene *> _scenes;
+	// Repacks and mounts the packages that were out of date at startup
+	std::thread _packThread;
 
 	Camera3D _camera = { 0 };
 	bool _showCursor = true;
+
+	// Highest level of the level allocator budgets, lowers the spawn rate under memory pressure
+	// Set by the pressure callback on whichever thread flushes the tracker
+	std::atomic<BudgetLevel> _spawnPressure{ BudgetLevel::Normal };
+	int _pressureCallback = -1;
 	unsigned int _width = 1280;
 	unsigned int _height = 720;
 
 	bool RenderInterface();
 	void RenderResources(Entity *ent);
+	// Number of entities to spawn in a wave of count entities under the current memory pressure
+	int GetSpawnCount(int count);
 
 	void Testing();
 
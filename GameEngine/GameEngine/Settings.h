@@ -6,6 +6,48 @@
 //#define TEST
 #define TRACK_MEMORY true
 
+// Maximum amount of bytes a compacting allocator moves per frame when defragmenting
+#define DEFRAG_BYTES_PER_FRAME 4096
+
+// Default budgets of the level allocators as fractions of their capacity
+// Above the soft limit fewer entities are spawned, above the hard limit spawning stops
+#define BUDGET_SOFT_FRACTION 0.75f
+#define BUDGET_HARD_FRACTION 0.95f
+
+// Replaces the global operator new/delete with counting versions (general heap traffic in the memory panel)
+#define TRACK_HEAP false
+
+// Size of the memory timeline (allocation events and per frame samples kept for graphs and export)
+#define TIMELINE_EVENT_CAPACITY 65536
+#define TIMELINE_FRAME_CAPACITY 600
+
+// Default for allocator arenas: 2 MiB aligned and backed by huge pages when the OS allows it (fewer TLB misses)
+#define HUGE_PAGE_ARENAS false
+
+// Packages are memory-mapped when mounted, assets are decompressed straight from the mapping
+#define MAP_PACKAGES true
+
+// Worker threads compressing files in PackageManager::Pack (0 = one per hardware thread)
+#define PACK_THREADS 0
+
+// Codec selection in PackageManager::Pack
+// Files that LZ4 shrinks by less than this fraction are stored uncompressed (and loaded without decompression)
+#define PACK_MIN_COMPRESSION_GAIN 0.05f
+// Files larger than this are split into independently compressed chunks (parallel and partial decompression)
+#define PACK_CHUNK_SIZE (256 * 1024)
+// Size of the LZ4 dictionary built from the small files of a package, shared by their entries (0 = no dictionary)
+#define PACK_DICTIONARY_SIZE (64 * 1024)
+// Threads decompressing the chunks of one large asset (0 = one per hardware thread)
+#define PACKAGE_DECOMPRESS_THREADS 0
+// Assets loaded together (PackageManager::LoadAssets) are read from streamed packages in runs of up to this many bytes
+#define PACKAGE_BATCH_READ_SIZE (8 * 1024 * 1024)
+// Gaps up to this size between the entries of a run are read and skipped instead of starting a new read
+#define PACKAGE_BATCH_READ_GAP (64 * 1024)
+// Reads kept in flight by async loads (io_uring queue depth, without io_uring a quarter of it is the minimum number of reading threads)
+#define PACKAGE_IO_QUEUE_DEPTH 64
+// Threads completing async loads, e.g. decompressing (0 = one per hardware thread)
+#define PACKAGE_IO_THREADS 0
+
 // May be subject to change
 
 #define MEMORY_STACK_OS true
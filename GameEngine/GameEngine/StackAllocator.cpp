@@ -1,39 +1,39 @@
 #include "StackAllocator.h"
 
-int StackAllocator::_nextId = 0;
+template <typename Tracking>
+int BasicStackAllocator<Tracking>::_nextId = 0;
 
-bool StackAllocator::Init(int size) {
+template <typename Tracking>
+bool BasicStackAllocator<Tracking>::Init(int size, bool hugePages) {
 
 	_size = size;
-	_start = malloc(size);
-	_head = _start;
-	int N = size / 4;
-	_blockSize = new int[N];
-	if (!_head) {
+	if (!ArenaMemory::Allocate(_arena, size, hugePages)) {
 		std::cerr << "StackAllocator::Initialize(): failed to allocate block" << std::endl;
 		return false;
 	}
+	_start = _arena.memory;
+	_head = _start;
+	int N = size / 4;
+	_blockSize = new int[N];
 
 	_id = _nextId;
 	_nextId++;
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().TrackAllocator(_id, GetStats());
-	}
+	Tracking::TrackAllocator(_id, GetStats());
 	return true;
 }
 
-StackAllocator::~StackAllocator() {
-	free(_start);
+template <typename Tracking>
+BasicStackAllocator<Tracking>::~BasicStackAllocator() {
+	ArenaMemory::Free(_arena);
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().RemoveAllocator(_id, Allocator::Stack);
-	}
+	Tracking::RemoveAllocator(_id, Allocator::Stack);
 	delete _blockSize;
 }
 
 // Copy a pointer to the start of the block and update head
-void* StackAllocator::Request(int size, std::string tag) {
+template <typename Tracking>
+void* BasicStackAllocator<Tracking>::Request(int size, Tag tag) {
 
 	void* block = _head;
 
@@ -47,9 +47,7 @@ void* StackAllocator::Request(int size, std::string tag) {
 	_index++;
 	_blockSize[_index] = size;
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().StartTracking(Allocator::Stack, _id, block, size, tag);
-	}
+	Tracking::StartTracking(Allocator::Stack, _id, block, size, tag);
 
 	return block;
 }
@@ -66,19 +64,19 @@ void* StackAllocator::Request(int size, std::string tag) {
 //	return true;
 //}
 
-bool StackAllocator::Free() {
+template <typename Tracking>
+bool BasicStackAllocator<Tracking>::Free() {
 	void* block = static_cast<char*>(_head) - _blockSize[_index];
 	_head = block;
 	_index--;
 
-	if (TRACK_MEMORY) {
-		MemoryTracker::Instance().StopTracking(block);
-	}
+	Tracking::StopTracking(block);
 
 	return true;
 }
 
-StackStats StackAllocator::GetStats()
+template <typename Tracking>
+StackStats BasicStackAllocator<Tracking>::GetStats()
 {
 	StackStats stats;
 	stats.capacity = _size;
@@ -88,7 +86,8 @@ StackStats StackAllocator::GetStats()
 	return stats;
 }
 
-bool StackAllocator::Reset() {
+template <typename Tracking>
+bool BasicStackAllocator<Tracking>::Reset() {
 	while (_index != -1) {
 		Free();
 	}
@@ -97,3 +96,6 @@ bool StackAllocator::Reset() {
 
 	return true;
 }
+
+template class BasicStackAllocator<MemoryTracking>;
+template class BasicStackAllocator<NoTracking>;
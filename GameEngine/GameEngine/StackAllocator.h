@@ -1,15 +1,20 @@
 #pragma once
 #include "Settings.h"
 #include "MemoryTracker.h"
+#include "TrackingPolicy.h"
+#include "ArenaMemory.h"
 #include <malloc.h>
 #include <iostream>
 
-class StackAllocator {
+// Tracking is a tracking policy (MemoryTracking or NoTracking, see TrackingPolicy.h)
+template <typename Tracking>
+class BasicStackAllocator {
 	
 private:
 	int _id;
 	static int _nextId;
 
+	Arena _arena;
 	void* _start;
 	void* _head;
 	int* _blockSize;
@@ -17,20 +22,24 @@ private:
 	int _index = -1;
 
 public:
-	StackAllocator() = default;
-	~StackAllocator();
+	BasicStackAllocator() = default;
+	~BasicStackAllocator();
 
 	int GetId() {
 		return _id;
 	}
 
 	// Allocate memory space for the stack (bytes)
-	bool Init(int size);
+	// If hugePages is true the arena is backed by huge pages when the OS allows it
+	bool Init(int size, bool hugePages = HUGE_PAGE_ARENAS);
 
-	void* Request(int size, std::string tag="No tag");
+	void* Request(int size, Tag tag = Tags::NoTag);
 	bool Free();
 
 	// Returns the current stats for the allocator
 	StackStats GetStats();
 	bool Reset();
-};
\ No newline at end of file
+};
+
+using StackAllocator = BasicStackAllocator<DefaultTracking>;
+using UntrackedStackAllocator = BasicStackAllocator<NoTracking>;
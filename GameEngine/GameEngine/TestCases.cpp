@@ -3,11 +3,14 @@
 #include "PoolAllocator.h"
 #include "StackAllocator.h"
 #include "BuddyAllocator.h"
+#include "CompactingAllocator.h"
 #include "Objects.h"
+#include "MemoryTracker.h"
 
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <algorithm>
 
 
 void PoolVSOS() {
@@ -26,7 +29,7 @@ void PoolVSOS() {
 		auto t0 = std::chrono::high_resolution_clock::now();
 
 
-		PoolAllocator pool;
+		UntrackedPoolAllocator pool;
 		pool.Init(startObjects, sizeof(Enemy));
 		std::vector<Enemy*> live;
 		for (int f = 0; f < FRAMES; f++) {
@@ -149,7 +152,7 @@ void StackVsOS() {
 	std::cout << "Testing StackAllocator: " << std::endl;
 	// Testing allocation framewise with our Stack
 	// reseting each iteration instead of deleting them
-	StackAllocator firstStack;
+	UntrackedStackAllocator firstStack;
 	firstStack.Init(100000);
 	t0 = std::chrono::high_resolution_clock::now();
 
@@ -268,7 +271,7 @@ void TestAll() {
 		std::cout << "--- BuddyAllocator ---" << std::endl;
 		auto t0 = std::chrono::high_resolution_clock::now();
 		std::vector<Enemy*> buddyPtrs;
-		BuddyAllocator buddy;
+		UntrackedBuddyAllocator buddy;
 		buddy.Init(std::pow(2,18));
 
 		for (int i = 0; i < frames; i++) {
@@ -316,4 +319,155 @@ void TestAll() {
 	}
 	result /= 10;
 	std::cout << "average time BuddyAllocator: " << result << std::endl;
-}	
\ No newline at end of file
+}
+
+void BuddyVsCompactingSoak() {
+	// Mixed size churn that fragments the arena over time, similar to the GREEN scene
+	const int frames = 10'000;
+	const unsigned int arenaSize = 1 << 16;
+	const unsigned int sizes[3] = { 24, 100, 400 };
+
+	std::mt19937 rng(12345);
+
+	std::cout << " ---- Soak testing BuddyAllocator ---- " << std::endl;
+	{
+		UntrackedBuddyAllocator buddy;
+		buddy.Init(arenaSize);
+		std::vector<void*> live;
+		int failed = 0;
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < 8; i++) {
+				void* ptr = buddy.Request(sizes[rng() % 3]);
+				if (!ptr) {
+					failed++;
+					continue;
+				}
+				live.push_back(ptr);
+			}
+			for (int i = 0; i < 8 && !live.empty(); i++) {
+				int index = rng() % live.size();
+				buddy.Free(live[index]);
+				live.erase(live.begin() + index);
+			}
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> duration = t1 - t0;
+
+		std::cout << "Failed requests: " << failed << std::endl;
+		std::cout << "Execution time: " << duration.count() << std::endl;
+	}
+
+	std::cout << " ---- Soak testing CompactingAllocator ---- " << std::endl;
+	{
+		UntrackedCompactingAllocator compacting;
+		compacting.Init(arenaSize);
+		std::vector<CompactingHandle> live;
+		int failed = 0;
+		unsigned int moved = 0;
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int i = 0; i < 8; i++) {
+				CompactingHandle handle = compacting.Request(sizes[rng() % 3]);
+				if (handle.index == UINT32_MAX) {
+					failed++;
+					continue;
+				}
+				live.push_back(handle);
+			}
+			for (int i = 0; i < 8 && !live.empty(); i++) {
+				int index = rng() % live.size();
+				compacting.Free(live[index]);
+				live.erase(live.begin() + index);
+			}
+
+			// Same per frame budget as the engine loop
+			moved += compacting.Defragment(DEFRAG_BYTES_PER_FRAME);
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> duration = t1 - t0;
+
+		std::cout << "Failed requests: " << failed << std::endl;
+		std::cout << "Bytes moved: " << moved << std::endl;
+		std::cout << "Execution time: " << duration.count() << std::endl;
+	}
+}
+
+void EntityIterationHugePages() {
+	// Random order access over a large entity arena, dominated by TLB misses when backed by 4 KiB pages
+	const int entityCounts[2] = { 10'000, 100'000 };
+	const int passes = 50;
+
+	std::mt19937 rng(12345);
+
+	for (int numEntities : entityCounts) {
+		for (int hugePages = 0; hugePages < 2; hugePages++) {
+			UntrackedPoolAllocator pool;
+			if (!pool.Init(numEntities, sizeof(EntityData), false, hugePages == 1)) {
+				std::cerr << "EntityIterationHugePages(): Failed to initialize pool" << std::endl;
+				return;
+			}
+
+			std::vector<EntityData*> entities;
+			entities.reserve(numEntities);
+			for (int i = 0; i < numEntities; i++) {
+				EntityData* entity = new (pool.Request()) EntityData;
+				entities.push_back(entity);
+			}
+			std::shuffle(entities.begin(), entities.end(), rng);
+
+			auto t0 = std::chrono::high_resolution_clock::now();
+			float checksum = 0.0f;
+			for (int p = 0; p < passes; p++) {
+				for (EntityData* entity : entities) {
+					entity->position[0] += entity->velocity[0];
+					checksum += entity->position[0];
+				}
+			}
+			auto t1 = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double, std::nano> duration = t1 - t0;
+
+			std::cout << numEntities << " entities (" << (hugePages ? "huge pages" : "regular pages") << "): "
+				<< duration.count() / (double(passes) * numEntities) << " ns per entity (checksum " << checksum << ")" << std::endl;
+
+			for (EntityData* entity : entities) {
+				pool.Free(entity);
+			}
+		}
+	}
+}
+
+void TrackingEventCost() {
+	// Cost of recording one tracking event on the allocating thread, and of applying it when the frame ends
+	const int frames = 200;
+	const int allocationsPerFrame = 500;
+	const int allocatorId = 1000; // Not used by any real allocator
+
+	MemoryTracker& tracker = MemoryTracker::Instance();
+	std::vector<char> memory(allocationsPerFrame * 16);
+
+	double recordTime = 0.0;
+	double flushTime = 0.0;
+	for (int f = 0; f < frames; f++) {
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < allocationsPerFrame; i++) {
+			tracker.StartTracking(Allocator::Pool, allocatorId, memory.data() + i * 16, 16, "TrackingEventCost");
+		}
+		for (int i = 0; i < allocationsPerFrame; i++) {
+			tracker.StopTracking(memory.data() + i * 16);
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		tracker.Flush();
+		auto t2 = std::chrono::high_resolution_clock::now();
+
+		recordTime += std::chrono::duration<double, std::nano>(t1 - t0).count();
+		flushTime += std::chrono::duration<double, std::nano>(t2 - t1).count();
+	}
+	tracker.RemoveAllocator(allocatorId, Allocator::Pool);
+
+	double events = 2.0 * frames * allocationsPerFrame;
+	std::cout << "Recording: " << recordTime / events << " ns per event" << std::endl;
+	std::cout << "Flushing: " << flushTime / events << " ns per event" << std::endl;
+}
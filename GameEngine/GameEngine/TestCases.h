@@ -2,4 +2,7 @@
 
 void PoolVSOS();
 void StackVsOS();
-void TestAll();
\ No newline at end of file
+void TestAll();
+void BuddyVsCompactingSoak();
+void EntityIterationHugePages();
+void TrackingEventCost();
\ No newline at end of file
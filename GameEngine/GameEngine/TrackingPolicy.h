@@ -0,0 +1,46 @@
+#pragma once
+
+#include <type_traits>
+
+#include "MemoryTracker.h"
+#include "Settings.h"
+
+// Tracking policies are passed as template parameters to the allocators
+// An allocator using NoTracking compiles down to its bare allocation path
+
+// Reports allocators and allocations to the MemoryTracker
+struct MemoryTracking {
+	static constexpr bool enabled = true;
+
+	template <typename Stats>
+	static void TrackAllocator(int id, const Stats& stats) {
+		MemoryTracker::Instance().TrackAllocator(id, stats);
+	}
+	static void RemoveAllocator(int id, Allocator allocator) {
+		MemoryTracker::Instance().RemoveAllocator(id, allocator);
+	}
+	static void StartTracking(Allocator allocator, int allocatorId, void* ptr, size_t size, Tag tag) {
+		MemoryTracker::Instance().StartTracking(allocator, allocatorId, ptr, size, tag);
+	}
+	static void StopTracking(void* ptr) {
+		MemoryTracker::Instance().StopTracking(ptr);
+	}
+	static void MoveTracking(void* from, void* to) {
+		MemoryTracker::Instance().MoveTracking(from, to);
+	}
+};
+
+// Does nothing
+struct NoTracking {
+	static constexpr bool enabled = false;
+
+	template <typename Stats>
+	static void TrackAllocator(int, const Stats&) {}
+	static void RemoveAllocator(int, Allocator) {}
+	static void StartTracking(Allocator, int, void*, size_t, Tag) {}
+	static void StopTracking(void*) {}
+	static void MoveTracking(void*, void*) {}
+};
+
+// Policy used by the default allocator types (PoolAllocator, StackAllocator, ...)
+using DefaultTracking = std::conditional_t<TRACK_MEMORY, MemoryTracking, NoTracking>;